@@ -0,0 +1,38 @@
+/** @file cycle_counter.hpp
+ *
+ * @date Oct 17, 2026
+ * @author Sylvain Garcia
+ */
+
+#pragma once
+
+extern "C" {
+#include <stm32f2xx_hal.h>
+}
+
+#include <cstdint>
+
+namespace stm32 {
+
+/** DWT cycle counter, wraps every 2^32 core cycles (~35s at 120MHz). */
+class cycle_counter {
+public:
+	using stamp = uint32_t;
+
+	static void enable() noexcept {
+		// no compound assignment on volatile registers, deprecated in C++20
+		CoreDebug->DEMCR = CoreDebug->DEMCR | CoreDebug_DEMCR_TRCENA_Msk;
+		DWT->CTRL = DWT->CTRL | DWT_CTRL_CYCCNTENA_Msk;
+	}
+
+	static stamp now() noexcept {
+		return DWT->CYCCNT;
+	}
+
+	/** Cycles elapsed from @a from to @a to, valid across one wrap. */
+	static constexpr stamp elapsed(stamp from, stamp to) noexcept {
+		return to - from;
+	}
+};
+
+}
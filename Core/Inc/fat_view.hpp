@@ -0,0 +1,171 @@
+/** @file fat_view.hpp
+ *
+ * @date Oct 17, 2026
+ * @author Sylvain Garcia
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+namespace stm32 {
+
+/** What fat_view exposes as its file: a byte source of bounded size. */
+template <typename Source>
+concept fat_source = requires (Source const &source, std::size_t offset, std::span<uint8_t> out) {
+	{Source::capacity} -> std::convertible_to<std::size_t>;
+	{source.size()} -> std::convertible_to<std::size_t>;
+	{source.read(offset, out)} -> std::convertible_to<std::size_t>;
+};
+
+/** Read-only FAT12 volume holding a single file, synthesized on the fly.
+ *
+ * Nothing but the source is stored: every block is computed when read. The
+ * volume is sized for Source::capacity at compile time, the file occupies
+ * contiguous clusters from cluster 2 and its size is the source size when
+ * the directory is read. Hosts cache the directory, so a file that grew
+ * shows up on the next mount.
+ *
+ * Layout: boot sector, one FAT, one root directory sector, data.
+ */
+template <fat_source Source>
+class fat_view {
+public:
+	static constexpr uint32_t block_size = 512;
+
+private:
+	static constexpr uint32_t clusters_ = std::max<uint32_t>((Source::capacity + block_size - 1) / block_size, 1);
+	static_assert(clusters_ < 4085, "fat_view only generates FAT12 volumes");
+
+	static constexpr uint32_t fat_blocks_ = ((clusters_ + 2) * 3 / 2 + 1 + block_size - 1) / block_size;
+	static constexpr uint32_t root_entries_ = block_size / 32;
+	static constexpr uint32_t fat_start_ = 1;
+	static constexpr uint32_t root_start_ = fat_start_ + fat_blocks_;
+	static constexpr uint32_t data_start_ = root_start_ + 1;
+
+	// 2026-10-17 12:00:00, FAT packed date and time
+	static constexpr uint16_t date_ = ((2026 - 1980) << 9) | (10 << 5) | 17;
+	static constexpr uint16_t time_ = 12 << 11;
+
+	Source const &source_;
+
+	static void put16(uint8_t *out, uint16_t value) noexcept {
+		out[0] = uint8_t(value);
+		out[1] = uint8_t(value >> 8);
+	}
+
+	static void put32(uint8_t *out, uint32_t value) noexcept {
+		put16(out, uint16_t(value));
+		put16(out + 2, uint16_t(value >> 16));
+	}
+
+	static void boot_sector(uint8_t *out) noexcept {
+		static constexpr uint8_t jump[] = {0xEB, 0x3C, 0x90};
+		std::memcpy(out, jump, sizeof(jump));
+		std::memcpy(out + 3, "MSWIN4.1", 8);
+		put16(out + 11, block_size);
+		out[13] = 1;                      // sectors per cluster
+		put16(out + 14, fat_start_);      // reserved sectors
+		out[16] = 1;                      // FAT copies
+		put16(out + 17, root_entries_);
+		put16(out + 19, uint16_t(block_count));
+		out[21] = 0xF8;                   // fixed media
+		put16(out + 22, fat_blocks_);
+		put16(out + 24, 1);               // sectors per track
+		put16(out + 26, 1);               // heads
+		out[36] = 0x80;                   // drive number
+		out[38] = 0x29;                   // extended boot signature
+		put32(out + 39, 0x20261017);      // volume serial
+		std::memcpy(out + 43, "STM32 LOGS ", 11);
+		std::memcpy(out + 54, "FAT12   ", 8);
+		out[510] = 0x55;
+		out[511] = 0xAA;
+	}
+
+	uint16_t fat_entry(uint32_t index, uint32_t used) const noexcept {
+		if (index < 2) {
+			return index == 0 ? 0xFF8 : 0xFFF;
+		}
+		if (index - 2 >= used) {
+			return 0;
+		}
+		return index - 2 + 1 == used ? 0xFFF : uint16_t(index + 1);
+	}
+
+	void fat_block(uint32_t block, uint8_t *out) const noexcept {
+		auto const used = clusters_used();
+		for (uint32_t ii = 0; ii < block_size; ++ii) {
+			// two 12-bit entries per three bytes
+			auto const offset = block * block_size + ii;
+			auto const pair = offset / 3;
+			auto const even = fat_entry(pair * 2, used);
+			auto const odd = fat_entry(pair * 2 + 1, used);
+			switch (offset % 3) {
+			case 0:
+				out[ii] = uint8_t(even);
+				break;
+			case 1:
+				out[ii] = uint8_t((even >> 8) | ((odd & 0x0F) << 4));
+				break;
+			default:
+				out[ii] = uint8_t(odd >> 4);
+				break;
+			}
+		}
+	}
+
+	void root_block(uint8_t *out) const noexcept {
+		std::memcpy(out, "STM32 LOGS ", 11);
+		out[11] = 0x08;                   // volume label
+		put16(out + 22, time_);
+		put16(out + 24, date_);
+
+		auto *file = out + 32;
+		std::memcpy(file, "LOG     TXT", 11);
+		file[11] = 0x01;                  // read-only
+		put16(file + 14, time_);
+		put16(file + 16, date_);
+		put16(file + 18, date_);
+		put16(file + 22, time_);
+		put16(file + 24, date_);
+		auto const size = file_size();
+		put16(file + 26, size ? 2 : 0);   // first cluster
+		put32(file + 28, uint32_t(size));
+	}
+
+	std::size_t file_size() const noexcept {
+		return std::min<std::size_t>(source_.size(), Source::capacity);
+	}
+
+	uint32_t clusters_used() const noexcept {
+		return uint32_t((file_size() + block_size - 1) / block_size);
+	}
+
+public:
+	static constexpr uint32_t block_count = data_start_ + clusters_;
+
+	explicit constexpr fat_view(Source const &source) noexcept:
+		source_{source} {
+	}
+
+	/** Fill @a out with block @a block, blocks past the end read as zeroes. */
+	void read(uint32_t block, std::span<uint8_t, block_size> out) const noexcept {
+		std::fill(out.begin(), out.end(), uint8_t{0});
+		if (block == 0) {
+			boot_sector(out.data());
+		} else if (block < root_start_) {
+			fat_block(block - fat_start_, out.data());
+		} else if (block == root_start_) {
+			root_block(out.data());
+		} else if (block < block_count) {
+			source_.read(std::size_t(block - data_start_) * block_size, out);
+		}
+	}
+};
+}
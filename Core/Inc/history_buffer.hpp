@@ -0,0 +1,80 @@
+/** @file history_buffer.hpp
+ *
+ * @date Oct 17, 2026
+ * @author Sylvain Garcia
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+
+namespace stm32 {
+
+/** Last @a Capacity bytes written, the oldest ones are overwritten first.
+ *
+ * Single context only (no synchronization): pushed to and drained from the
+ * same thread. A zero capacity keeps nothing.
+ */
+template <std::size_t Capacity>
+class history_buffer {
+
+	std::array<char, Capacity> data_{};
+	std::size_t head_ = 0; ///< next byte written
+	std::size_t size_ = 0;
+	std::size_t overwritten_ = 0;
+
+	void copy_in(std::string_view data) noexcept {
+		auto const first = std::min(data.size(), Capacity - head_);
+		std::memcpy(data_.data() + head_, data.data(), first);
+		std::memcpy(data_.data(), data.data() + first, data.size() - first);
+		head_ = (head_ + data.size()) % Capacity;
+	}
+
+public:
+
+	static constexpr std::size_t capacity = Capacity;
+
+	void push(std::string_view data) noexcept {
+		if constexpr (Capacity == 0) {
+			overwritten_ += data.size();
+		} else {
+			if (size_ + data.size() > Capacity) {
+				overwritten_ += size_ + data.size() - Capacity;
+			}
+			if (data.size() > Capacity) {
+				data = data.substr(data.size() - Capacity);
+			}
+			copy_in(data);
+			size_ = std::min(size_ + data.size(), Capacity);
+		}
+	}
+
+	/** Call @a fn with the kept bytes, oldest first, in at most two parts, then forget them. */
+	template <typename Fn>
+	void drain(Fn &&fn) noexcept {
+		if (size_ == 0) {
+			return;
+		}
+		auto const start = (head_ + Capacity - size_) % Capacity;
+		auto const first = std::min(size_, Capacity - start);
+		fn(std::string_view{data_.data() + start, first});
+		if (size_ > first) {
+			fn(std::string_view{data_.data(), size_ - first});
+		}
+		size_ = 0;
+	}
+
+	std::size_t size() const noexcept {
+		return size_;
+	}
+
+	/** Bytes lost because newer ones took their place. */
+	std::size_t overwritten() const noexcept {
+		return overwritten_;
+	}
+};
+}
@@ -0,0 +1,94 @@
+/** @file host_timer.hpp
+ *
+ * @date Oct 17, 2026
+ * @author Sylvain Garcia
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace stm32 {
+
+/** Stand-in for tim2_clock off target: time only moves when told to. */
+struct host_clock {
+	using rep = int64_t;
+	using period = std::micro;
+	using duration = std::chrono::duration<rep, period>;
+	using time_point = std::chrono::time_point<host_clock>;
+	static constexpr bool is_steady = true;
+
+	static time_point now() noexcept {
+		return now_;
+	}
+
+	static void advance(duration elapsed) noexcept {
+		now_ += elapsed;
+	}
+
+	inline static time_point now_{};
+};
+
+/** Stand-in for tim2_timer, lets tickless_context run on a development host.
+ *
+ * Sleeping jumps host_clock to the armed compare time, as if the compare
+ * interrupt woke the core; with nothing armed idle_hook is called instead
+ * (typically to inject an event or stop the context).
+ *
+ * The io_deadlines alarm is only recorded: tests advance host_clock past it
+ * and call io_deadlines::expire() themselves.
+ */
+struct host_timer {
+	using clock = host_clock;
+
+	struct lock {
+		lock() noexcept {
+		}
+	};
+
+	static void start() noexcept {
+	}
+
+	static bool arm(clock::time_point due) noexcept {
+		if (!(clock::now() < due)) {
+			return false;
+		}
+		armed_ = true;
+		due_ = due;
+		arms_ += 1;
+		return true;
+	}
+
+	static void disarm() noexcept {
+		armed_ = false;
+	}
+
+	static void alarm(clock::time_point due) noexcept {
+		alarm_armed_ = true;
+		alarm_due_ = due;
+	}
+
+	static void cancel_alarm() noexcept {
+		alarm_armed_ = false;
+	}
+
+	static void idle() noexcept {
+		idles_ += 1;
+		if (armed_) {
+			armed_ = false;
+			clock::now_ = due_;
+		} else if (idle_hook != nullptr) {
+			idle_hook();
+		}
+	}
+
+	inline static void (*idle_hook)() = nullptr;
+	inline static bool armed_ = false;
+	inline static clock::time_point due_{};
+	inline static bool alarm_armed_ = false;
+	inline static clock::time_point alarm_due_{};
+	inline static uint32_t arms_ = 0;  ///< compare programmings
+	inline static uint32_t idles_ = 0; ///< sleeps, i.e. wake-up interrupts
+};
+}
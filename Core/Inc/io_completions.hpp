@@ -0,0 +1,74 @@
+/** @file io_completions.hpp
+ *
+ * @date Oct 17, 2026
+ * @author Sylvain Garcia
+ */
+
+#pragma once
+
+#include <post_queue.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace stm32 {
+
+/** True in an exception handler.
+ *
+ * On the host, true in the thread standing in for an interrupt, which sets
+ * host_isr::active.
+ */
+#if defined(__arm__)
+inline bool in_isr() noexcept {
+	uint32_t ipsr;
+	__asm volatile ("mrs %0, ipsr" : "=r" (ipsr));
+	return ipsr != 0;
+}
+#else
+struct host_isr {
+	inline static thread_local bool active = false;
+};
+
+inline bool in_isr() noexcept {
+	return host_isr::active;
+}
+#endif
+
+/** I/O completions an interrupt handler handed over to the thread.
+ *
+ * An operation with a registered stop callback must not be completed from
+ * an interrupt: destroying the callback waits for a stop request running on
+ * the thread, which the interrupt preempted. Such completions are posted
+ * here in constant time and delivered by drain(), called from the main loop
+ * (tickless_context::run() does). Work an interrupt must not do itself, such
+ * as writev() staging into the transmit buffer, is handed over the same way.
+ */
+class io_completions {
+public:
+	struct node {
+		using deliver_fn = void (*)(node &) noexcept;
+
+		deliver_fn deliver_ = nullptr;
+		node *next_ = nullptr;
+	};
+
+	/** Any side. */
+	static void post(node &n) noexcept {
+		queue_.push(n);
+	}
+
+	static bool empty() noexcept {
+		return queue_.empty();
+	}
+
+	/** Thread side: deliver everything posted so far, returns how many. */
+	static std::size_t drain() noexcept {
+		return queue_.drain([](node &n) noexcept {
+			n.deliver_(n);
+		});
+	}
+
+private:
+	inline static post_queue<node> queue_{};
+};
+}
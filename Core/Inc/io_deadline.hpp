@@ -0,0 +1,132 @@
+/** @file io_deadline.hpp
+ *
+ * @date Oct 17, 2026
+ * @author Sylvain Garcia
+ */
+
+#pragma once
+
+#if defined(__arm__)
+#include <tim2_timer.hpp>
+#else
+#include <host_timer.hpp>
+#endif
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+namespace stm32 {
+
+/** Timer whose second compare channel expires I/O deadlines, see io_deadlines. */
+#if defined(__arm__)
+using io_timer = tim2_timer;
+#else
+using io_timer = host_timer;
+#endif
+
+/** Clock of I/O deadlines, the scheduler clock: microseconds. */
+using io_clock = io_timer::clock;
+
+/** When an I/O operation gives up, never by default. */
+struct io_deadline {
+	io_clock::time_point at{};
+	bool armed = false;
+
+	constexpr io_deadline() noexcept = default;
+
+	io_deadline(io_clock::time_point when) noexcept:
+		at{when}, armed{true} {
+	}
+
+	template <typename Rep, typename Period>
+	io_deadline(std::chrono::duration<Rep, Period> timeout) noexcept:
+		at{io_clock::now() + std::chrono::duration_cast<io_clock::duration>(timeout)}, armed{true} {
+	}
+};
+
+/** Deadline of one operation, linked into io_deadlines while armed. */
+struct io_deadline_node {
+	using expire_fn = void (*)(io_deadline_node &) noexcept;
+
+	expire_fn const expire_;
+	io_clock::time_point at_{};
+};
+
+/** Fixed registry of armed deadlines, expired by a one-shot alarm.
+ *
+ * Arming and disarming are single compare-and-swap operations on a slot, the
+ * alarm interrupt claims an expired slot the same way before calling its
+ * expiry, so a deadline fires at most once and never after disarm() returned
+ * true. The alarm (io_timer::alarm(), a TIM2 compare) is programmed for the
+ * earliest armed deadline, nothing wakes the core while none is armed. It
+ * must run at the same priority as the I/O interrupts whose operations it
+ * expires.
+ */
+class io_deadlines {
+public:
+	static constexpr std::size_t capacity = 8;
+
+	static bool arm(io_deadline_node &node) noexcept {
+		for (auto &slot : slots_) {
+			io_deadline_node *expected = nullptr;
+			if (slot.compare_exchange_strong(expected, &node, std::memory_order_acq_rel)) {
+				schedule();
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/** False if the deadline already fired (or is firing).
+	 *
+	 * The alarm is left as is, it expires nothing when it fires.
+	 */
+	static bool disarm(io_deadline_node &node) noexcept {
+		for (auto &slot : slots_) {
+			io_deadline_node *expected = &node;
+			if (slot.compare_exchange_strong(expected, nullptr, std::memory_order_acq_rel)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/** Expire due deadlines and program the alarm for the next one (alarm interrupt). */
+	static void expire() noexcept {
+		auto const now = io_clock::now();
+		for (auto &slot : slots_) {
+			auto *node = slot.load(std::memory_order_acquire);
+			if (node == nullptr || now < node->at_) {
+				continue;
+			}
+			if (slot.compare_exchange_strong(node, nullptr, std::memory_order_acq_rel)) {
+				node->expire_(*node);
+			}
+		}
+		schedule();
+	}
+
+private:
+	static void schedule() noexcept {
+		io_timer::lock guard{};
+		std::optional<io_clock::time_point> earliest;
+		for (auto &slot : slots_) {
+			auto const *node = slot.load(std::memory_order_acquire);
+			if (node != nullptr && (!earliest || node->at_ < *earliest)) {
+				earliest = node->at_;
+			}
+		}
+		if (earliest) {
+			io_timer::alarm(*earliest);
+		} else {
+			io_timer::cancel_alarm();
+		}
+	}
+
+	inline static std::array<std::atomic<io_deadline_node *>, capacity> slots_{};
+};
+}
@@ -6,10 +6,23 @@
 
 #pragma once
 
+#include <io_completions.hpp>
+#include <io_deadline.hpp>
+#include <isr_binding.hpp>
+
 #include <unifex/manual_lifetime.hpp>
 #include <unifex/get_stop_token.hpp>
 #include <unifex/receiver_concepts.hpp>
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <system_error>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
 namespace stm32 {
 
 template<class Operation>
@@ -22,8 +35,41 @@ concept StoppableIoOperation = requires (Operation &op) {
 	{op.stop_io()};
 };
 
+/** Completion state of an I/O operation.
+ *
+ * pending → completing → done. Whoever moves the operation out of pending
+ * (an interrupt, start_io or the stop path) owns it until it either
+ * completes the receiver or hands it back with resume_pending().
+ */
+enum class io_state : uint8_t {
+	pending,
+	completing,
+	done,
+};
+
+/** Base of interrupt-driven operations.
+ *
+ * start_io() and stop_io() are called with the operation claimed. Interrupt
+ * handlers must call try_claim() before touching anything, and an operation
+ * that needs to wait again must re-bind itself to its interrupt before
+ * calling resume_pending().
+ *
+ * stop_io() detaches the operation from its interrupts, the operation then
+ * completes with set_done. A stop_io() returning bool may return true to
+ * take over that completion instead, either because it already completed
+ * (e.g. with partial data) or because it cannot complete yet: a transfer
+ * still reading the caller buffer completes it from its interrupt once the
+ * hardware released it. This happens on cancellation and when the optional
+ * deadline given at construction expires.
+ *
+ * A completion reached from an interrupt while a stop callback is registered
+ * is not delivered there: its values are kept in the operation and it is
+ * posted to io_completions, the thread then destroys the callback and
+ * completes the receiver. The interrupt side stays constant time and never
+ * waits on a stop request it preempted.
+ */
 template <template<class...> typename Operation, typename Receiver>
-class io_operation_base {
+class io_operation_base : private io_deadline_node, private io_completions::node {
 
     struct cancel_callback {
     	io_operation_base &op_;
@@ -38,39 +84,151 @@ class io_operation_base {
 
 	Receiver receiver_;
     bool can_be_cancelled_;
+    bool has_stop_callback_ = false;
+    std::atomic<io_state> state_{io_state::pending};
+    std::atomic<bool> stop_requested_{false};
+    bool has_deadline_;
+    /// values of a completion deferred to the thread
+    alignas(std::max_align_t) std::byte deferred_[4 * sizeof(void *)];
+
+    static void on_deadline(io_deadline_node &node) noexcept {
+    	static_cast<io_operation_base &>(node).request_stop();
+    }
+
+    void teardown() noexcept {
+    	if (has_deadline_) {
+    		has_deadline_ = false;
+    		io_deadlines::disarm(*this);
+    	}
+		if constexpr (is_stop_ever_possible) {
+			if (has_stop_callback_) {
+				has_stop_callback_ = false;
+				stop_callback_.destruct();
+			}
+		}
+		state_.store(io_state::done, std::memory_order_release);
+    }
+
+    bool must_defer() const noexcept {
+    	if constexpr (is_stop_ever_possible) {
+    		return has_stop_callback_ && in_isr();
+    	} else {
+    		return false;
+    	}
+    }
+
+    template <typename Cpo, typename...Args>
+    void complete(Cpo const &cpo, Args&&...args) noexcept {
+    	if (must_defer()) {
+    		defer<Cpo>(std::forward<Args>(args)...);
+    		return;
+    	}
+    	teardown();
+    	cpo(std::move(receiver_), std::forward<Args>(args)...);
+    }
+
+    template <typename Cpo, typename...Args>
+    void defer(Args&&...args) noexcept {
+    	using values = std::tuple<std::decay_t<Args>...>;
+    	static_assert(sizeof(values) <= sizeof(deferred_), "completion too large to be deferred");
+    	new (deferred_) values{std::forward<Args>(args)...};
+    	this->deliver_ = [](io_completions::node &node) noexcept {
+    		auto &self = static_cast<io_operation_base &>(node);
+    		auto &stored = *std::launder(reinterpret_cast<values *>(self.deferred_));
+    		auto taken = std::move(stored);
+    		stored.~values();
+    		self.teardown();
+    		std::apply([&self](auto &&...args) {
+    			Cpo{}(std::move(self.receiver_), std::move(args)...);
+    		}, std::move(taken));
+    	};
+    	io_completions::post(*this);
+    }
 
 protected:
 
-    io_operation_base(Receiver &&r) noexcept:
+    io_operation_base(Receiver &&r, io_deadline deadline = {}) noexcept:
+		io_deadline_node{&on_deadline, deadline.at},
 		receiver_{(Receiver &&)r},
-		can_be_cancelled_{unifex::get_stop_token(receiver_).stop_possible()} {
+		can_be_cancelled_{unifex::get_stop_token(receiver_).stop_possible()},
+		has_deadline_{deadline.armed} {
 	}
 
+	// completions, only valid while the operation is claimed
+
 	template <typename...Args>
 	void set_value(Args&&...values) && {
-		if constexpr (is_stop_ever_possible) {
-			stop_callback_.destruct();
-		}
-		unifex::set_value(std::move(*this).receiver_, std::forward<Args>(values)...);
+		complete(unifex::set_value, std::forward<Args>(values)...);
+	}
+
+	template <typename Error>
+	void set_error(Error &&error) && {
+		complete(unifex::set_error, std::forward<Error>(error));
+	}
+
+	void set_done() && {
+		complete(unifex::set_done);
 	}
 
 public:
 	void start() noexcept {
+		// held during start so a stop requested inline is only recorded
+		try_claim();
 		if constexpr (is_stop_ever_possible) {
-			stop_callback_.construct(unifex::get_stop_token(receiver_), cancel_callback{*this});
+			if (can_be_cancelled_) {
+				stop_callback_.construct(unifex::get_stop_token(receiver_), cancel_callback{*this});
+				has_stop_callback_ = true;
+			}
+		}
+		if (has_deadline_ && !io_deadlines::arm(*this)) {
+			has_deadline_ = false;
+			std::move(*this).set_error(std::make_error_code(std::errc::no_buffer_space));
+			return;
 		}
 		if constexpr (StartableIoOperation<Operation<Receiver>>) {
 			static_cast<Operation<Receiver>*>(this)->start_io();
+		} else {
+			resume_pending();
 		}
 	}
 
+	/** Move the operation from pending to completing, exactly one caller wins. */
+	bool try_claim() noexcept {
+		auto expected = io_state::pending;
+		return state_.compare_exchange_strong(expected, io_state::completing, std::memory_order_acq_rel);
+	}
+
+	/** Hand a claimed operation back because it has to wait for more I/O.
+	 *
+	 * @return false when a stop was requested in the meantime, the stop path
+	 * has then been run and the operation must not be touched anymore.
+	 */
+	bool resume_pending() noexcept {
+		state_.store(io_state::pending, std::memory_order_release);
+		if (stop_requested_.load(std::memory_order_acquire)) {
+			request_stop();
+			return false;
+		}
+		return true;
+	}
+
 	void request_stop() noexcept {
-		if constexpr (is_stop_ever_possible) {
-			stop_callback_.destruct();
+		stop_requested_.store(true, std::memory_order_release);
+		if (!try_claim()) {
+			// completing elsewhere, or claimed by a path that will see stop_requested_
+			return;
 		}
 		if constexpr (StoppableIoOperation<Operation<Receiver>>) {
-			static_cast<Operation<Receiver>*>(this)->stop_io();
+			auto &op = *static_cast<Operation<Receiver>*>(this);
+			if constexpr (std::is_same_v<decltype(op.stop_io()), bool>) {
+				if (op.stop_io()) {
+					return;
+				}
+			} else {
+				op.stop_io();
+			}
 		}
+		std::move(*this).set_done();
 	}
 };
 }
@@ -0,0 +1,100 @@
+/** @file isr_binding.hpp
+ *
+ * @date Oct 17, 2026
+ * @author Sylvain Garcia
+ */
+
+#pragma once
+
+#include <atomic>
+
+namespace stm32 {
+
+/** Something waiting for the @a Event interrupt of @a Peripheral.
+ *
+ * The completion function is fixed when the waiter is constructed, so
+ * publishing the waiter pointer is enough to publish what to call.
+ */
+template <typename Peripheral, typename Event>
+class isr_waiter {
+public:
+	using complete_fn = void (*)(isr_waiter &) noexcept;
+
+	explicit constexpr isr_waiter(complete_fn complete) noexcept:
+		complete_{complete} {
+	}
+
+	void complete() noexcept {
+		complete_(*this);
+	}
+
+private:
+	complete_fn const complete_;
+};
+
+/** CRTP helper binding Derived::on_isr(Event) as the waiter completion.
+ *
+ * Each operation type gets its own thunk, which calls Derived::on_isr
+ * directly so that on_isr is inlined into it. The interrupt still reaches
+ * the thunk with one indirect call through the waiter, because the binding
+ * cannot know the type of the operation waiting on it.
+ */
+template <typename Derived, typename Peripheral, typename Event>
+class isr_operation : public isr_waiter<Peripheral, Event> {
+
+	static void thunk(isr_waiter<Peripheral, Event> &waiter) noexcept {
+		static_cast<Derived &>(static_cast<isr_operation &>(waiter)).on_isr(Event{});
+	}
+
+protected:
+	constexpr isr_operation() noexcept:
+		isr_waiter<Peripheral, Event>{&thunk} {
+	}
+};
+
+/** One-shot binding between an interrupt source and the operation it completes.
+ *
+ * There is one binding per (Peripheral, Event) pair, resolved at compile
+ * time; the only runtime state is the bound waiter pointer. Binding and
+ * claiming are single atomic operations (LDREX/STREX on Cortex-M3), so
+ * the interrupt and the thread side never both complete a waiter and no
+ * interrupt masking is needed.
+ */
+template <typename Peripheral, typename Event>
+class isr_binding {
+public:
+	using waiter = isr_waiter<Peripheral, Event>;
+
+	/** Make @a w the target of the next interrupt. */
+	static void bind(waiter &w) noexcept {
+		waiter_.store(&w, std::memory_order_release);
+	}
+
+	/** Take @a w back, false if the interrupt already claimed it. */
+	static bool unbind(waiter &w) noexcept {
+		waiter *expected = &w;
+		return waiter_.compare_exchange_strong(expected, nullptr, std::memory_order_acq_rel);
+	}
+
+	/** Take whatever is bound, the caller becomes responsible for completing it. */
+	static waiter *claim() noexcept {
+		return waiter_.exchange(nullptr, std::memory_order_acq_rel);
+	}
+
+	static bool bound(waiter const &w) noexcept {
+		return waiter_.load(std::memory_order_acquire) == &w;
+	}
+
+	/** Interrupt side: complete the bound waiter, if any. */
+	static bool fire() noexcept {
+		if (auto *w = claim()) {
+			w->complete();
+			return true;
+		}
+		return false;
+	}
+
+private:
+	inline static std::atomic<waiter *> waiter_{nullptr};
+};
+}
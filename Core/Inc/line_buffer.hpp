@@ -0,0 +1,159 @@
+/** @file line_buffer.hpp
+ *
+ * @date Oct 17, 2026
+ * @author Sylvain Garcia
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace stm32 {
+
+/** What to do with a line longer than the reassembly buffer. */
+enum class line_overflow {
+	discard,  ///< drop it silently, up to and including its delimiter
+	truncate, ///< deliver the first bytes, drop the rest up to the delimiter
+	error,    ///< report std::errc::message_size, drop it up to the delimiter
+};
+
+/** Index of the first '\n' in [data, data + size), or size when there is none.
+ *
+ * Scans one machine word at a time using the classic "has zero byte" trick on
+ * the word xor-ed with the delimiter. Its borrows only run towards higher
+ * bytes, so only the lowest flagged byte is exact: the word must be little
+ * endian for it to be the first one in memory.
+ */
+inline std::size_t find_newline(const char *data, std::size_t size) noexcept {
+	static_assert(std::endian::native == std::endian::little, "find_newline takes the lowest flagged byte");
+	using word = std::uintptr_t;
+	constexpr word ones = ~word{0} / 0xFF;
+	constexpr word highs = ones * 0x80;
+	constexpr word pattern = ones * '\n';
+
+	std::size_t pos = 0;
+	for (; pos + sizeof(word) <= size; pos += sizeof(word)) {
+		word w;
+		std::memcpy(&w, data + pos, sizeof(word));
+		w ^= pattern;
+		if (auto const found = (w - ones) & ~w & highs) {
+			return pos + std::countr_zero(found) / 8;
+		}
+	}
+	for (; pos < size; ++pos) {
+		if (data[pos] == '\n') {
+			return pos;
+		}
+	}
+	return size;
+}
+
+/** Reassembles "\r\n" delimited lines out of arbitrarily split chunks. */
+template <std::size_t Capacity>
+class line_buffer {
+	static_assert(Capacity > 1, "room for a delimiter and what precedes it");
+
+public:
+
+	enum class status {
+		none,      ///< no complete line yet
+		line,      ///< a complete line (delimiter included)
+		truncated, ///< the head of an oversized line (line_overflow::truncate)
+		overflow,  ///< an oversized line was dropped (line_overflow::error)
+	};
+
+	struct result {
+		line_buffer::status status;
+		std::string_view line;
+	};
+
+	static constexpr std::size_t capacity() noexcept {
+		return Capacity;
+	}
+
+	/** Append as much of @a data as fits, returns the number of bytes taken. */
+	std::size_t append(std::string_view data) noexcept {
+		compact();
+		auto const count = std::min(data.size(), Capacity - end_);
+		std::memcpy(data_.data() + end_, data.data(), count);
+		end_ += count;
+		return count;
+	}
+
+	/** Extract the next line.
+	 *
+	 * The returned view is valid until the next call to append() or next().
+	 */
+	result next(line_overflow policy) noexcept {
+		compact();
+		while (true) {
+			auto const pos = scanned_ + find_newline(data_.data() + scanned_, end_ - scanned_);
+			if (pos == end_) {
+				scanned_ = end_;
+				if (end_ < Capacity) {
+					return {status::none, {}};
+				}
+				// buffer full without delimiter
+				bool const first = !discarding_;
+				if (first) {
+					++overflows_;
+				}
+				discarding_ = true;
+				// keep a trailing '\r', the next chunk may start with its '\n'
+				begin_ = data_[end_ - 1] == '\r' ? end_ - 1 : end_;
+				if (first && policy == line_overflow::truncate) {
+					return {status::truncated, {data_.data(), Capacity}};
+				}
+				if (first && policy == line_overflow::error) {
+					return {status::overflow, {}};
+				}
+				return {status::none, {}};
+			}
+			scanned_ = pos + 1;
+			if (pos == 0 || data_[pos - 1] != '\r') {
+				// bare '\n' is part of the line
+				continue;
+			}
+			std::string_view line{data_.data(), pos + 1};
+			begin_ = pos + 1;
+			if (discarding_) {
+				// tail of an oversized line
+				discarding_ = false;
+				compact();
+				continue;
+			}
+			return {status::line, line};
+		}
+	}
+
+	/** Number of lines that did not fit in the buffer. */
+	std::size_t overflows() const noexcept {
+		return overflows_;
+	}
+
+private:
+
+	void compact() noexcept {
+		if (begin_ == 0) {
+			return;
+		}
+		std::memmove(data_.data(), data_.data() + begin_, end_ - begin_);
+		end_ -= begin_;
+		scanned_ = scanned_ > begin_ ? scanned_ - begin_ : 0;
+		begin_ = 0;
+	}
+
+	std::array<char, Capacity> data_{};
+	std::size_t begin_ = 0;
+	std::size_t end_ = 0;
+	std::size_t scanned_ = 0;
+	std::size_t overflows_ = 0;
+	bool discarding_ = false;
+};
+}
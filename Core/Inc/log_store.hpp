@@ -0,0 +1,89 @@
+/** @file log_store.hpp
+ *
+ * @date Oct 17, 2026
+ * @author Sylvain Garcia
+ */
+
+#pragma once
+
+#include <static_format.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string_view>
+
+namespace stm32 {
+
+/** Append-only text log kept in RAM.
+ *
+ * One writer (the main loop) appends whole records, readers (the mass
+ * storage interrupt) only ever see the published prefix: bytes below size()
+ * never change, so they can be read without locking. Records that do not
+ * fit anymore are dropped and counted.
+ */
+template <std::size_t Capacity>
+class log_store {
+
+	std::array<uint8_t, Capacity> data_{};
+	std::atomic<std::size_t> size_{0};
+	std::atomic<std::size_t> dropped_{0};
+
+	template <typename Writer>
+	bool append_with(std::size_t max_size, Writer &&write) noexcept {
+		auto const size = size_.load(std::memory_order_relaxed);
+		if (max_size > Capacity - size) {
+			dropped_.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		auto const written = write(reinterpret_cast<char *>(data_.data() + size));
+		size_.store(size + written, std::memory_order_release);
+		return true;
+	}
+
+public:
+
+	static constexpr std::size_t capacity = Capacity;
+
+	/** Append @a record as is, all or nothing. */
+	bool append(std::string_view record) noexcept {
+		return append_with(record.size(), [record](char *out) noexcept {
+			std::memcpy(out, record.data(), record.size());
+			return record.size();
+		});
+	}
+
+	/** Format a record in place, see static_format. */
+	template <ctll::fixed_string Format, typename...Args>
+	bool print(Args const &...args) noexcept {
+		using format = static_format<Format>;
+		return append_with(format::max_size(args...), [&args...](char *out) noexcept {
+			return format::format_to(out, args...);
+		});
+	}
+
+	/** Published size, in bytes. */
+	std::size_t size() const noexcept {
+		return size_.load(std::memory_order_acquire);
+	}
+
+	/** Copy the published bytes from @a offset, returns how many were copied. */
+	std::size_t read(std::size_t offset, std::span<uint8_t> out) const noexcept {
+		auto const size = this->size();
+		if (offset >= size) {
+			return 0;
+		}
+		auto const count = std::min(out.size(), size - offset);
+		std::memcpy(out.data(), data_.data() + offset, count);
+		return count;
+	}
+
+	std::size_t dropped() const noexcept {
+		return dropped_.load(std::memory_order_relaxed);
+	}
+};
+}
@@ -0,0 +1,22 @@
+/** @file log_volume.hpp
+ *
+ * @date Oct 17, 2026
+ * @author Sylvain Garcia
+ */
+
+#pragma once
+
+#include <fat_view.hpp>
+#include <log_store.hpp>
+
+namespace stm32 {
+
+/** Application log, exported as LOG.TXT when USBD_ENABLE_MSC is set. */
+using app_log = log_store<16 * 1024>;
+
+/** Only defined when USBD_ENABLE_MSC is set, calls must be guarded the same way. */
+app_log &logs() noexcept;
+
+/** Read-only FAT volume over logs(), read by usbd_msc_ro.c. */
+using log_volume = fat_view<app_log>;
+}
@@ -0,0 +1,165 @@
+/** @file packet_pool.hpp
+ *
+ * @date Oct 17, 2026
+ * @author Sylvain Garcia
+ */
+
+#pragma once
+
+#include <spsc_ring.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace stm32 {
+
+/** Fixed pool of receive buffers shared between an endpoint and its consumer.
+ *
+ * Slots cycle through three owners:
+ *  - the endpoint (interrupt side), which receives into exactly one slot,
+ *  - the ready ring, once the interrupt side committed it,
+ *  - the consumer, until it releases the slot back to the free ring.
+ *
+ * When no free slot is left on commit, the pool parks: the endpoint must not
+ * be re-armed and the host is NAKed until the consumer releases a slot.
+ *
+ * Releases feed the free ring, which has a single producer: the consumer may
+ * release from the thread or from an interrupt, as long as two releases
+ * never overlap.
+ */
+template <std::size_t Count, std::size_t Size>
+class packet_pool {
+	static_assert(Count <= 255, "packet_pool indexes are 8-bit");
+
+public:
+
+	static constexpr uint8_t no_slot = 0xFF;
+
+	struct slot {
+		alignas(4) std::array<uint8_t, Size> data;
+		std::size_t size;
+		uint32_t stamp; ///< cycle stamp taken when the packet was received
+	};
+
+	packet_pool() noexcept {
+		for (std::size_t ii = 0; ii < Count; ++ii) {
+			free_.push(uint8_t(ii));
+		}
+	}
+
+	static constexpr std::size_t count() noexcept {
+		return Count;
+	}
+
+	slot &operator[](uint8_t index) noexcept {
+		return slots_[index];
+	}
+
+	// interrupt side
+
+	/** Buffer the endpoint should be armed with, or nullptr when parked. */
+	uint8_t *arm() noexcept {
+		if (filling_ == no_slot) {
+			filling_ = take_free();
+		}
+		return filling_ == no_slot ? nullptr : slots_[filling_].data.data();
+	}
+
+	/** Commit @a size bytes received in the armed slot at @a stamp.
+	 *
+	 * @return the next buffer to arm the endpoint with, or nullptr to leave it NAKing.
+	 */
+	uint8_t *commit(std::size_t size, uint32_t stamp = 0) noexcept {
+		if (filling_ == no_slot) {
+			dropped_.fetch_add(1, std::memory_order_relaxed);
+		} else {
+			slots_[filling_].size = size < Size ? size : Size;
+			slots_[filling_].stamp = stamp;
+			ready_.push(filling_);
+			filling_ = no_slot;
+		}
+		if (auto *buffer = arm()) {
+			return buffer;
+		}
+		parks_.fetch_add(1, std::memory_order_relaxed);
+		parked_.store(true, std::memory_order_release);
+		// a slot may have been released between take_free() and parking
+		if (!free_.empty() && parked_.exchange(false, std::memory_order_acq_rel)) {
+			return arm();
+		}
+		return nullptr;
+	}
+
+	// consumer side
+
+	/** Oldest received slot index, or no_slot. */
+	uint8_t acquire() noexcept {
+		auto *index = ready_.front();
+		if (index == nullptr) {
+			return no_slot;
+		}
+		auto const value = *index;
+		ready_.pop();
+		return value;
+	}
+
+	bool has_ready() const noexcept {
+		return !ready_.empty();
+	}
+
+	/** Give @a index back to the endpoint.
+	 *
+	 * @return the buffer to re-arm the endpoint with when it was parked, nullptr otherwise.
+	 */
+	uint8_t *release(uint8_t index) noexcept {
+		free_.push(index);
+		if (parked_.exchange(false, std::memory_order_acq_rel)) {
+			return arm();
+		}
+		return nullptr;
+	}
+
+	// any side
+
+	/** Number of times the endpoint was left NAKing for lack of a free slot. */
+	std::size_t parks() const noexcept {
+		return parks_.load(std::memory_order_relaxed);
+	}
+
+	/** Number of packets received while no slot was armed. */
+	std::size_t dropped() const noexcept {
+		return dropped_.load(std::memory_order_relaxed);
+	}
+
+private:
+
+	uint8_t take_free() noexcept {
+		auto *index = free_.front();
+		if (index == nullptr) {
+			return no_slot;
+		}
+		auto const value = *index;
+		free_.pop();
+		return value;
+	}
+
+	// rings need a power-of-two capacity, round Count up
+	static constexpr std::size_t ring_size() noexcept {
+		std::size_t size = 1;
+		while (size < Count) {
+			size <<= 1;
+		}
+		return size;
+	}
+
+	std::array<slot, Count> slots_{};
+	spsc_ring<uint8_t, ring_size()> ready_{};
+	spsc_ring<uint8_t, ring_size()> free_{};
+	uint8_t filling_ = no_slot;
+	std::atomic<bool> parked_{false};
+	std::atomic<std::size_t> parks_{0};
+	std::atomic<std::size_t> dropped_{0};
+};
+}
@@ -0,0 +1,62 @@
+/** @file post_queue.hpp
+ *
+ * @date Oct 17, 2026
+ * @author Sylvain Garcia
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace stm32 {
+
+/** Lock-free multi-producer, single-consumer handoff of intrusive nodes.
+ *
+ * push() may be called from any interrupt handler or from the thread: it is
+ * one compare-and-swap (LDREX/STREX on Cortex-M3), retried only when a
+ * nested interrupt pushed in the meantime, so its time does not depend on
+ * the queue length. The consumer takes everything at once with drain() and
+ * gets it oldest first. @a Node provides a `Node *next_` link, owned by the
+ * queue from push() until the node is handed to the drain function.
+ */
+template <typename Node>
+class post_queue {
+	static_assert(std::atomic<Node *>::is_always_lock_free);
+
+	std::atomic<Node *> head_{nullptr}; ///< newest first
+
+public:
+	void push(Node &n) noexcept {
+		auto *head = head_.load(std::memory_order_relaxed);
+		do {
+			n.next_ = head;
+		} while (!head_.compare_exchange_weak(head, &n, std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	bool empty() const noexcept {
+		return head_.load(std::memory_order_acquire) == nullptr;
+	}
+
+	/** Consumer side: call @a fn with every posted node, oldest first, returns how many. */
+	template <typename Fn>
+	std::size_t drain(Fn &&fn) noexcept {
+		auto *n = head_.exchange(nullptr, std::memory_order_acquire);
+		Node *oldest = nullptr;
+		while (n != nullptr) {
+			auto *next = n->next_;
+			n->next_ = oldest;
+			oldest = n;
+			n = next;
+		}
+		std::size_t count = 0;
+		while (oldest != nullptr) {
+			auto *next = oldest->next_;
+			fn(*oldest);
+			oldest = next;
+			count += 1;
+		}
+		return count;
+	}
+};
+}
@@ -0,0 +1,95 @@
+/** @file spsc_ring.hpp
+ *
+ * @date Oct 17, 2026
+ * @author Sylvain Garcia
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace stm32 {
+
+/** Fixed-capacity single-producer/single-consumer lock-free ring.
+ *
+ * The producer (usually an interrupt handler) fills slots in place with
+ * prepare()/commit(), the consumer reads them in place with front()/pop().
+ * Only head_ and tail_ are shared, each one written by a single side, so
+ * no interrupt masking is needed on the consumer side.
+ */
+template <typename T, std::size_t Capacity>
+class spsc_ring {
+	static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+			"spsc_ring capacity must be a power of two");
+
+	std::array<T, Capacity> slots_{};
+	std::atomic<std::size_t> head_{0};
+	std::atomic<std::size_t> tail_{0};
+	std::atomic<std::size_t> overflows_{0};
+
+public:
+
+	static constexpr std::size_t capacity() noexcept {
+		return Capacity;
+	}
+
+	// producer side
+
+	/** Slot to fill, or nullptr (and overflow accounted) when the ring is full. */
+	T *prepare() noexcept {
+		auto const head = head_.load(std::memory_order_relaxed);
+		if (head - tail_.load(std::memory_order_acquire) == Capacity) {
+			overflows_.fetch_add(1, std::memory_order_relaxed);
+			return nullptr;
+		}
+		return &slots_[head & (Capacity - 1)];
+	}
+
+	/** Publish the slot returned by prepare(). */
+	void commit() noexcept {
+		head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	bool push(T const &value) noexcept {
+		if (auto *slot = prepare()) {
+			*slot = value;
+			commit();
+			return true;
+		}
+		return false;
+	}
+
+	// consumer side
+
+	/** Oldest published slot, or nullptr when the ring is empty. */
+	T *front() noexcept {
+		auto const tail = tail_.load(std::memory_order_relaxed);
+		if (head_.load(std::memory_order_acquire) == tail) {
+			return nullptr;
+		}
+		return &slots_[tail & (Capacity - 1)];
+	}
+
+	/** Give the slot returned by front() back to the producer. */
+	void pop() noexcept {
+		tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	// any side
+
+	bool empty() const noexcept {
+		return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+	}
+
+	std::size_t size() const noexcept {
+		return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+	}
+
+	/** Number of prepare() calls that found the ring full. */
+	std::size_t overflows() const noexcept {
+		return overflows_.load(std::memory_order_relaxed);
+	}
+};
+}
@@ -0,0 +1,167 @@
+/** @file static_format.hpp
+ *
+ * @date Oct 17, 2026
+ * @author Sylvain Garcia
+ */
+
+#pragma once
+
+#include <ctll/fixed_string.hpp>
+
+#include <array>
+#include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace stm32 {
+
+namespace detail {
+// not constexpr: reaching it while parsing a format string fails the build
+void format_error(const char *) noexcept;
+
+enum class format_kind {
+	decimal, ///< "{}" or "{:d}"
+	hex,     ///< "{:x}", lowercase, no prefix
+};
+
+struct format_piece {
+	std::size_t begin; ///< literal text preceding the argument, in text
+	std::size_t size;
+	format_kind kind;
+};
+
+template <typename T>
+concept format_integer = std::integral<T> && !std::same_as<T, bool> && !std::same_as<T, char>;
+
+template <typename T>
+concept format_string = std::convertible_to<T const &, std::string_view>;
+}
+
+/** Format string parsed at compile time, "{}" placeholders, "{{" and "}}" escapes.
+ *
+ * Integers are written in decimal ("{}", "{:d}") or hexadecimal ("{:x}"),
+ * strings, chars and bools as text. Nothing is allocated: max_size() bounds
+ * the output for given arguments and format_to() writes it in place.
+ */
+template <ctll::fixed_string Format>
+class static_format {
+
+	struct parsed {
+		std::array<char, Format.size() + 1> text{};
+		std::array<detail::format_piece, Format.size() / 2 + 1> pieces{};
+		std::size_t text_size = 0;
+		std::size_t args = 0;
+	};
+
+	static constexpr parsed parse() noexcept {
+		parsed result{};
+		std::size_t begin = 0;
+		for (std::size_t ii = 0; ii < Format.size(); ++ii) {
+			auto const c = Format[ii];
+			if (c > 0x7F) {
+				detail::format_error("only ASCII format strings are supported");
+			}
+			if (c == '}') {
+				if (ii + 1 >= Format.size() || Format[ii + 1] != '}') {
+					detail::format_error("unmatched '}' in format string");
+				}
+				result.text[result.text_size++] = '}';
+				++ii;
+			} else if (c != '{') {
+				result.text[result.text_size++] = char(c);
+			} else if (ii + 1 < Format.size() && Format[ii + 1] == '{') {
+				result.text[result.text_size++] = '{';
+				++ii;
+			} else {
+				auto kind = detail::format_kind::decimal;
+				if (ii + 3 < Format.size() && Format[ii + 1] == ':' && Format[ii + 3] == '}') {
+					if (Format[ii + 2] == 'x') {
+						kind = detail::format_kind::hex;
+					} else if (Format[ii + 2] != 'd') {
+						detail::format_error("unsupported format specifier");
+					}
+					ii += 3;
+				} else if (ii + 1 < Format.size() && Format[ii + 1] == '}') {
+					ii += 1;
+				} else {
+					detail::format_error("unterminated '{' in format string");
+				}
+				result.pieces[result.args++] = {begin, result.text_size - begin, kind};
+				begin = result.text_size;
+			}
+		}
+		// trailing literal
+		result.pieces[result.args] = {begin, result.text_size - begin, detail::format_kind::decimal};
+		return result;
+	}
+
+	static constexpr parsed parsed_ = parse();
+
+	template <typename T>
+	static constexpr std::size_t arg_size(T const &value) noexcept {
+		if constexpr (std::same_as<T, bool>) {
+			return 5;
+		} else if constexpr (std::same_as<T, char>) {
+			return 1;
+		} else if constexpr (detail::format_integer<T>) {
+			// hex never needs more than decimal plus sign
+			return std::numeric_limits<T>::digits10 + 2;
+		} else {
+			static_assert(detail::format_string<T>, "unsupported format argument");
+			return std::string_view{value}.size();
+		}
+	}
+
+	template <typename T>
+	static char *put(char *out, detail::format_kind kind, T const &value) noexcept {
+		if constexpr (std::same_as<T, bool>) {
+			return put(out, kind, value ? std::string_view{"true"} : std::string_view{"false"});
+		} else if constexpr (std::same_as<T, char>) {
+			*out = value;
+			return out + 1;
+		} else if constexpr (detail::format_integer<T>) {
+			auto const base = kind == detail::format_kind::hex ? 16 : 10;
+			return std::to_chars(out, out + arg_size(value), value, base).ptr;
+		} else {
+			std::string_view const text{value};
+			std::memcpy(out, text.data(), text.size());
+			return out + text.size();
+		}
+	}
+
+	static char *put_text(char *out, std::size_t index) noexcept {
+		auto const &piece = parsed_.pieces[index];
+		std::memcpy(out, parsed_.text.data() + piece.begin, piece.size);
+		return out + piece.size;
+	}
+
+public:
+
+	/** Number of "{}" placeholders. */
+	static constexpr std::size_t arg_count = parsed_.args;
+
+	/** Upper bound of format_to() output for @a args. */
+	template <typename...Args>
+	static constexpr std::size_t max_size(Args const &...args) noexcept {
+		static_assert(sizeof...(Args) == arg_count, "argument count does not match the format string");
+		return parsed_.text_size + (std::size_t{0} + ... + arg_size(args));
+	}
+
+	/** Write the formatted output at @a out, returns its size. */
+	template <typename...Args>
+	static std::size_t format_to(char *out, Args const &...args) noexcept {
+		static_assert(sizeof...(Args) == arg_count, "argument count does not match the format string");
+		auto *const begin = out;
+		[&]<std::size_t...I>(std::index_sequence<I...>) {
+			((out = put(put_text(out, I), parsed_.pieces[I].kind, args)), ...);
+		}(std::index_sequence_for<Args...>{});
+		out = put_text(out, arg_count);
+		return std::size_t(out - begin);
+	}
+};
+}
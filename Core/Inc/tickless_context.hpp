@@ -0,0 +1,605 @@
+/** @file tickless_context.hpp
+ *
+ * @date Oct 17, 2026
+ * @author Sylvain Garcia
+ */
+
+#pragma once
+
+#include <io_completions.hpp>
+#include <post_queue.hpp>
+#include <timing_wheel.hpp>
+
+#include <unifex/manual_lifetime.hpp>
+#include <unifex/get_stop_token.hpp>
+#include <unifex/receiver_concepts.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <type_traits>
+#include <utility>
+
+namespace stm32 {
+
+/** Run queue of scheduled work, see tickless_context::get_scheduler(). */
+enum class priority : uint8_t {
+	high,	///< latency critical, e.g. command dispatch
+	normal,
+	low,	///< housekeeping
+};
+
+/** Single-threaded execution context driven by a one-shot hardware timer.
+ *
+ * run() executes scheduled work on the calling thread (the main loop). When
+ * nothing is ready it programs @a Timer for the earliest pending timer only
+ * and sleeps until an interrupt, so no periodic tick is needed and timers
+ * have the resolution of Timer::clock. Pending timers are kept in a
+ * timing_wheel, starting or cancelling one is constant time.
+ *
+ * @a Timer provides:
+ *  - clock: a chrono clock,
+ *  - start(): called once by the constructor,
+ *  - bool arm(time_point): interrupt at the given time, false if already due,
+ *  - disarm(),
+ *  - idle(): sleep until an interrupt is pending, called with interrupts masked,
+ *  - lock: RAII guard masking interrupts.
+ *
+ * schedule() and schedule_at() may be started from interrupt handlers, their
+ * completion always runs in run(). A stopped timer completes with done, on
+ * the context as well.
+ *
+ * Work handed over from outside run(), schedule() and stopped timers, goes
+ * through a lock-free post_queue: starting it from an interrupt handler is
+ * one compare-and-swap whatever the work it triggers, and run() drains
+ * everything posted in one batch, along with the I/O completions handlers
+ * deferred to io_completions. Interrupts are only masked around the
+ * timing wheel, whose updates are constant time.
+ *
+ * Ready work is queued per priority, one FIFO per level: run() always takes
+ * the oldest item of the highest non-empty level, expired timers join the
+ * queue of the scheduler they were started from. Levels are not preemptive,
+ * a running item completes first.
+ */
+template <typename Timer>
+class tickless_context {
+public:
+	using clock = typename Timer::clock;
+	using time_point = typename clock::time_point;
+	using duration = typename clock::duration;
+
+	static constexpr std::size_t priorities = std::size_t(priority::low) + 1;
+
+	/** Ready queue occupancy of a priority level. */
+	struct queue_stats {
+		std::size_t depth;
+		std::size_t high_water;
+	};
+
+private:
+	using lock = typename Timer::lock;
+
+	struct task_base {
+		using execute_fn = void (*)(task_base &) noexcept;
+
+		execute_fn execute_;
+		task_base *next_ = nullptr;
+		priority priority_ = priority::normal;
+
+		void execute() noexcept {
+			execute_(*this);
+		}
+	};
+
+	struct timer_task : task_base, timer_node<clock> {
+	};
+
+	struct ready_queue {
+		task_base *head_ = nullptr;
+		task_base *tail_ = nullptr;
+		std::size_t depth_ = 0;
+		std::size_t high_water_ = 0;
+	};
+
+	std::array<ready_queue, priorities> ready_{}; ///< run() only
+	post_queue<task_base> posted_{};
+	std::size_t batch_high_water_ = 0;
+	timing_wheel<clock> timers_{};
+	std::atomic<bool> stop_{false};
+
+	/** Append to the ready queue of its priority. */
+	void push_ready(task_base &task) noexcept {
+		auto &queue = ready_[std::size_t(task.priority_)];
+		task.next_ = nullptr;
+		if (queue.tail_ == nullptr) {
+			queue.head_ = &task;
+		} else {
+			queue.tail_->next_ = &task;
+		}
+		queue.tail_ = &task;
+		queue.depth_ += 1;
+		queue.high_water_ = std::max(queue.high_water_, queue.depth_);
+	}
+
+	/** Oldest task of the highest non-empty level. */
+	task_base *pop_ready() noexcept {
+		for (auto &queue : ready_) {
+			auto *task = queue.head_;
+			if (task != nullptr) {
+				queue.head_ = task->next_;
+				if (queue.head_ == nullptr) {
+					queue.tail_ = nullptr;
+				}
+				queue.depth_ -= 1;
+				return task;
+			}
+		}
+		return nullptr;
+	}
+
+	void enqueue(task_base &task) noexcept {
+		posted_.push(task);
+	}
+
+	void enqueue(timer_task &task) noexcept {
+		lock guard{};
+		timers_.insert(task);
+	}
+
+	/** Post a pending timer to run() with @a execute, false if it already fired. */
+	bool cancel(timer_task &task, typename task_base::execute_fn execute) noexcept {
+		{
+			lock guard{};
+			if (!timers_.remove(task)) {
+				return false;
+			}
+		}
+		task.execute_ = execute;
+		posted_.push(task);
+		return true;
+	}
+
+	struct schedule_sender {
+
+	    template <typename Receiver>
+		struct operation : task_base {
+			tickless_context &context_;
+			Receiver receiver_;
+
+			operation(tickless_context &context, priority level, Receiver &&r) noexcept:
+				task_base{&execute_impl, nullptr, level},
+				context_{context},
+				receiver_{(Receiver &&)r} {
+			}
+
+			void start() noexcept {
+				context_.enqueue(static_cast<task_base &>(*this));
+			}
+
+		private:
+			static void execute_impl(task_base &task) noexcept {
+				auto &self = static_cast<operation &>(task);
+				unifex::set_value(std::move(self.receiver_));
+			}
+		};
+
+	    template <
+	        template <typename...> class Variant,
+	        template <typename...> class Tuple>
+	    using value_types = Variant<Tuple<>>;
+
+	    template <template <typename...> class Variant>
+	    using error_types = Variant<>;
+
+	    static constexpr bool sends_done = false;
+
+	    tickless_context &context_;
+	    priority level_;
+
+	    template <typename Receiver>
+	    operation<std::remove_cvref_t<Receiver>> connect(Receiver&& r) && {
+	      return operation<std::remove_cvref_t<Receiver>>{context_, level_, (Receiver &&) r};
+	    }
+	};
+
+	struct schedule_at_sender {
+
+	    template <typename Receiver>
+		struct operation : timer_task {
+
+		    struct cancel_callback {
+		    	operation &op_;
+
+		        void operator()() noexcept {
+		        	op_.context_.cancel(op_, &operation::done_impl);
+		        }
+		    };
+
+		    static constexpr bool is_stop_ever_possible = !unifex::is_stop_never_possible_v<unifex::stop_token_type_t<Receiver>>;
+
+			tickless_context &context_;
+			Receiver receiver_;
+		    unifex::manual_lifetime<typename unifex::stop_token_type_t<Receiver>::template callback_type<cancel_callback>>
+		        stop_callback_{};
+
+			operation(tickless_context &context, time_point due, priority level, Receiver &&r) noexcept:
+				timer_task{{&value_impl, nullptr, level}, {due}},
+				context_{context},
+				receiver_{(Receiver &&)r} {
+			}
+
+			void start() noexcept {
+				if constexpr (is_stop_ever_possible) {
+					auto token = unifex::get_stop_token(receiver_);
+					if (token.stop_requested()) {
+						unifex::set_done(std::move(receiver_));
+						return;
+					}
+					// queued before the callback exists: a stop racing start() only cancels a queued timer
+					context_.enqueue(static_cast<timer_task &>(*this));
+					stop_callback_.construct(std::move(token), cancel_callback{*this});
+				} else {
+					context_.enqueue(static_cast<timer_task &>(*this));
+				}
+			}
+
+		private:
+			void teardown() noexcept {
+				if constexpr (is_stop_ever_possible) {
+					stop_callback_.destruct();
+				}
+			}
+
+			static void value_impl(task_base &task) noexcept {
+				auto &self = static_cast<operation &>(static_cast<timer_task &>(task));
+				self.teardown();
+				unifex::set_value(std::move(self.receiver_));
+			}
+
+			static void done_impl(task_base &task) noexcept {
+				auto &self = static_cast<operation &>(static_cast<timer_task &>(task));
+				self.teardown();
+				unifex::set_done(std::move(self.receiver_));
+			}
+		};
+
+	    template <
+	        template <typename...> class Variant,
+	        template <typename...> class Tuple>
+	    using value_types = Variant<Tuple<>>;
+
+	    template <template <typename...> class Variant>
+	    using error_types = Variant<>;
+
+	    static constexpr bool sends_done = true;
+
+	    tickless_context &context_;
+	    time_point due_;
+	    priority level_;
+
+	    template <typename Receiver>
+	    operation<std::remove_cvref_t<Receiver>> connect(Receiver&& r) && {
+	      return operation<std::remove_cvref_t<Receiver>>{context_, due_, level_, (Receiver &&) r};
+	    }
+	};
+
+public:
+
+	/** Ticks every period from a fixed epoch, see scheduler::schedule_every().
+	 *
+	 * The k-th deadline is epoch + k * period whatever the latency of the
+	 * previous ones, so there is no drift. next() sends the number of periods
+	 * that were missed since the previous tick (0 when on time) and the
+	 * following deadline is the first one still ahead: late ticks are skipped,
+	 * not delivered in a burst. One timer node, the stream itself, is reused
+	 * for every tick, hence a stream must not be moved once next() has been
+	 * called. A stopped next() completes with done on the context.
+	 *
+	 * A period is one clock tick at least: a shorter one given at
+	 * construction is raised to it, period() refuses it.
+	 */
+	class every_stream : timer_task {
+
+		struct waiter {
+			using value_fn = void (*)(waiter &, uint32_t missed) noexcept;
+			using done_fn = void (*)(waiter &) noexcept;
+
+			value_fn value_;
+			done_fn done_;
+		};
+
+		struct next_sender {
+
+		    template <typename Receiver>
+			struct operation : waiter {
+
+			    struct cancel_callback {
+			    	operation &op_;
+
+			        void operator()() noexcept {
+			        	op_.stream_.cancel();
+			        }
+			    };
+
+			    static constexpr bool is_stop_ever_possible = !unifex::is_stop_never_possible_v<unifex::stop_token_type_t<Receiver>>;
+
+				every_stream &stream_;
+				Receiver receiver_;
+			    unifex::manual_lifetime<typename unifex::stop_token_type_t<Receiver>::template callback_type<cancel_callback>>
+			        stop_callback_{};
+
+				operation(every_stream &stream, Receiver &&r) noexcept:
+					waiter{&value_impl, &done_impl},
+					stream_{stream},
+					receiver_{(Receiver &&)r} {
+				}
+
+				void start() noexcept {
+					if constexpr (is_stop_ever_possible) {
+						auto token = unifex::get_stop_token(receiver_);
+						if (token.stop_requested()) {
+							unifex::set_done(std::move(receiver_));
+							return;
+						}
+						stream_.arm(*this);
+						stop_callback_.construct(std::move(token), cancel_callback{*this});
+					} else {
+						stream_.arm(*this);
+					}
+				}
+
+			private:
+				void teardown() noexcept {
+					if constexpr (is_stop_ever_possible) {
+						stop_callback_.destruct();
+					}
+				}
+
+				static void value_impl(waiter &w, uint32_t missed) noexcept {
+					auto &self = static_cast<operation &>(w);
+					self.teardown();
+					unifex::set_value(std::move(self.receiver_), missed);
+				}
+
+				static void done_impl(waiter &w) noexcept {
+					auto &self = static_cast<operation &>(w);
+					self.teardown();
+					unifex::set_done(std::move(self.receiver_));
+				}
+			};
+
+		    template <
+		        template <typename...> class Variant,
+		        template <typename...> class Tuple>
+		    using value_types = Variant<Tuple<uint32_t>>;
+
+		    template <template <typename...> class Variant>
+		    using error_types = Variant<>;
+
+		    static constexpr bool sends_done = true;
+
+		    every_stream &stream_;
+
+		    template <typename Receiver>
+		    operation<std::remove_cvref_t<Receiver>> connect(Receiver&& r) && {
+		      return operation<std::remove_cvref_t<Receiver>>{stream_, (Receiver &&) r};
+		    }
+		};
+
+		struct cleanup_sender {
+
+		    template <typename Receiver>
+			struct operation {
+		    	Receiver receiver_;
+
+		    	void start() noexcept {
+		    		unifex::set_value(std::move(receiver_));
+		    	}
+			};
+
+		    template <
+		        template <typename...> class Variant,
+		        template <typename...> class Tuple>
+		    using value_types = Variant<Tuple<>>;
+
+		    template <template <typename...> class Variant>
+		    using error_types = Variant<>;
+
+		    static constexpr bool sends_done = false;
+
+		    template <typename Receiver>
+		    operation<std::remove_cvref_t<Receiver>> connect(Receiver&& r) && {
+		      return operation<std::remove_cvref_t<Receiver>>{(Receiver &&) r};
+		    }
+		};
+
+		tickless_context &context_;
+		time_point epoch_;
+		duration period_;
+		int64_t index_ = 1; ///< of the next deadline
+		waiter *waiter_ = nullptr;
+
+		void arm(waiter &w) noexcept {
+			waiter_ = &w;
+			this->execute_ = &fire;
+			this->due_ = epoch_ + period_ * index_;
+			context_.enqueue(static_cast<timer_task &>(*this));
+		}
+
+		void cancel() noexcept {
+			context_.cancel(*this, &cancelled);
+		}
+
+		static void fire(task_base &task) noexcept {
+			auto &self = static_cast<every_stream &>(static_cast<timer_task &>(task));
+			auto const late = clock::now() - self.due_;
+			auto const missed = late < duration::zero() ? 0 : late / self.period_;
+			self.index_ += 1 + missed;
+			auto *w = std::exchange(self.waiter_, nullptr);
+			w->value_(*w, uint32_t(std::min<int64_t>(missed, UINT32_MAX)));
+		}
+
+		static void cancelled(task_base &task) noexcept {
+			auto &self = static_cast<every_stream &>(static_cast<timer_task &>(task));
+			auto *w = std::exchange(self.waiter_, nullptr);
+			w->done_(*w);
+		}
+
+	public:
+
+		every_stream(tickless_context &context, duration period, priority level) noexcept:
+			timer_task{{nullptr, nullptr, level}, {}},
+			context_{context},
+			epoch_{clock::now()},
+			period_{std::max(period, duration{1})} {
+		}
+
+		every_stream(every_stream &&other) noexcept:
+			timer_task{{nullptr, nullptr, other.priority_}, {}},
+			context_{other.context_},
+			epoch_{other.epoch_},
+			period_{other.period_},
+			index_{other.index_} {
+		}
+
+		duration period() const noexcept {
+			return period_;
+		}
+
+		/** Change the period from the next deadline on, which keeps the current one as epoch.
+		 *
+		 * Not while a next() is pending.
+		 *
+		 * @return false, and the period unchanged, when @a period is not positive
+		 */
+		bool period(duration period) noexcept {
+			if (period <= duration::zero()) {
+				return false;
+			}
+			epoch_ += period_ * (index_ - 1);
+			index_ = 1;
+			period_ = period;
+			return true;
+		}
+
+		next_sender next() noexcept {
+			return next_sender{*this};
+		}
+
+		cleanup_sender cleanup() noexcept {
+			return cleanup_sender{};
+		}
+	};
+
+	class scheduler {
+		tickless_context *context_;
+		priority level_;
+
+	public:
+		scheduler(tickless_context &context, priority level) noexcept:
+			context_{&context},
+			level_{level} {
+		}
+
+		schedule_sender schedule() const noexcept {
+			return schedule_sender{*context_, level_};
+		}
+
+		schedule_at_sender schedule_at(time_point due) const noexcept {
+			return schedule_at_sender{*context_, due, level_};
+		}
+
+		template <typename Rep, typename Period>
+		schedule_at_sender schedule_after(std::chrono::duration<Rep, Period> delay) const noexcept {
+			return schedule_at(now() + std::chrono::duration_cast<duration>(delay));
+		}
+
+		/** Periodic ticks starting now, see every_stream. */
+		template <typename Rep, typename Period>
+		every_stream schedule_every(std::chrono::duration<Rep, Period> period) const noexcept {
+			return every_stream{*context_, std::chrono::duration_cast<duration>(period), level_};
+		}
+
+		time_point now() const noexcept {
+			return clock::now();
+		}
+
+		friend bool operator==(scheduler const &lhs, scheduler const &rhs) noexcept {
+			return lhs.context_ == rhs.context_ && lhs.level_ == rhs.level_;
+		}
+	};
+
+	tickless_context() noexcept {
+		Timer::start();
+	}
+
+	tickless_context(tickless_context const &) = delete;
+
+	/** Scheduler whose work runs before the one of lower @a level. */
+	scheduler get_scheduler(priority level = priority::normal) noexcept {
+		return scheduler{*this, level};
+	}
+
+	/** Ready queue of @a level, from the context thread only. */
+	queue_stats stats(priority level) const noexcept {
+		auto const &queue = ready_[std::size_t(level)];
+		return {queue.depth_, queue.high_water_};
+	}
+
+	/** Most tasks posted between two drains, from the context thread only. */
+	std::size_t batch_high_water() const noexcept {
+		return batch_high_water_;
+	}
+
+	/** Execute work until stop(), sleeping whenever nothing is due. */
+	void run() noexcept {
+		while (!stop_.load(std::memory_order_acquire)) {
+			io_completions::drain();
+			auto const batch = posted_.drain([this](task_base &task) noexcept {
+				push_ready(task);
+			});
+			batch_high_water_ = std::max(batch_high_water_, batch);
+			{
+				lock guard{};
+				auto const now = clock::now();
+				while (auto *timer = timers_.pop_due(now)) {
+					push_ready(static_cast<timer_task &>(*timer));
+				}
+			}
+			auto *task = pop_ready();
+			if (task == nullptr) {
+				lock guard{};
+				if (!posted_.empty() || !io_completions::empty()) {
+					continue; // posted meanwhile
+				}
+				auto next = timers_.next_expiry();
+				if (!next) {
+					Timer::disarm();
+				} else if (!Timer::arm(*next)) {
+					continue; // became due meanwhile
+				}
+				// wakes up on any interrupt, even masked: work started by a
+				// handler is seen once the guard let the handler run
+				Timer::idle();
+				continue;
+			}
+			task->execute();
+		}
+	}
+
+	/** Make run() return once the current work item completed. */
+	void stop() noexcept {
+		stop_.store(true, std::memory_order_release);
+	}
+};
+
+/** Drift-free periodic stream of @a scheduler, see tickless_context::every_stream. */
+template <typename Scheduler, typename Rep, typename Period>
+auto schedule_every(Scheduler const &scheduler, std::chrono::duration<Rep, Period> period) noexcept {
+	return scheduler.schedule_every(period);
+}
+}
@@ -0,0 +1,83 @@
+/** @file tim2_timer.hpp
+ *
+ * @date Oct 17, 2026
+ * @author Sylvain Garcia
+ */
+
+#pragma once
+
+extern "C" {
+#include <stm32f2xx_hal.h>
+}
+
+#include <chrono>
+#include <cstdint>
+
+namespace stm32 {
+
+/** Free running 1MHz clock on the 32-bit TIM2, extended to 64 bits by counting overflows. */
+struct tim2_clock {
+	using rep = int64_t;
+	using period = std::micro;
+	using duration = std::chrono::duration<rep, period>;
+	using time_point = std::chrono::time_point<tim2_clock>;
+	static constexpr bool is_steady = true;
+
+	static time_point now() noexcept;
+
+	/** Overflows of TIM2->CNT, bumped by the update interrupt. */
+	inline static volatile uint32_t epochs_ = 0;
+};
+
+/** One-shot wake-up on TIM2 channel 1 compare, tickless_context timer policy.
+ *
+ * Channel 2 is the alarm of io_deadlines.
+ */
+struct tim2_timer {
+	using clock = tim2_clock;
+
+	class lock {
+		uint32_t primask_;
+
+	public:
+		lock() noexcept:
+			primask_{__get_PRIMASK()} {
+			__disable_irq();
+		}
+
+		~lock() {
+			__set_PRIMASK(primask_);
+		}
+
+		lock(lock const &) = delete;
+	};
+
+	/** Run TIM2 at 1MHz, again after a clock change without losing the time.
+	 *
+	 * Also the HAL time base: HAL_InitTick() calls it, HAL_GetTick() reads
+	 * tim2_clock, see tim2_timer.cpp.
+	 */
+	static void start() noexcept;
+
+	/** Compare interrupt at @a due, false when it is already due. */
+	static bool arm(clock::time_point due) noexcept;
+
+	static void disarm() noexcept {
+		TIM2->DIER = TIM2->DIER & ~TIM_DIER_CC1IE;
+	}
+
+	/** Compare interrupt on channel 2 at @a due, right away when already due. */
+	static void alarm(clock::time_point due) noexcept;
+
+	static void cancel_alarm() noexcept {
+		TIM2->DIER = TIM2->DIER & ~TIM_DIER_CC2IE;
+	}
+
+	static void idle() noexcept {
+		__DSB();
+		__WFI();
+	}
+
+	static void on_interrupt() noexcept;
+};
+}
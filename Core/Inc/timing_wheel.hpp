@@ -0,0 +1,260 @@
+/** @file timing_wheel.hpp
+ *
+ * @date Oct 17, 2026
+ * @author Sylvain Garcia
+ */
+
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+namespace stm32 {
+
+/** Intrusive link of a pending timer, see timing_wheel. */
+template <typename Clock>
+struct timer_node {
+	typename Clock::time_point due_{};
+	timer_node *next_ = nullptr;
+	timer_node *prev_ = nullptr; ///< tail when this is the head of a list
+	uint8_t level_ = 0;
+	uint8_t slot_ = 0;
+	bool queued_ = false;
+};
+
+/** Pending timers in a hierarchical timing wheel, one tick per Clock::duration.
+ *
+ * @a Levels wheels of 2^@a SlotBits slots each, a slot of level n spans
+ * 2^(n * SlotBits) ticks. Insertion and removal are O(1); advancing moves
+ * whole slots: a slot of level 0 expires at once, a slot of an upper level is
+ * spread over the lower ones when time enters it. Timers beyond the last
+ * level wait in its farthest slot and are placed again when it opens.
+ *
+ * Sized at compile time and allocation free: the wheel is one pointer per
+ * slot plus a bitmap per level. Not synchronized: the owner serializes
+ * accesses.
+ */
+template <typename Clock, std::size_t SlotBits = 6, std::size_t Levels = 4>
+class timing_wheel {
+	static_assert(SlotBits > 0 && SlotBits <= 6, "a level bitmap is 64 bits at most");
+	static_assert(Levels > 0 && Levels * SlotBits < 64);
+
+public:
+	using node = timer_node<Clock>;
+	using time_point = typename Clock::time_point;
+	using duration = typename Clock::duration;
+
+	static constexpr std::size_t slots = std::size_t{1} << SlotBits;
+
+	/** Ticks covered before timers have to be placed again. */
+	static constexpr uint64_t horizon = uint64_t{1} << (SlotBits * Levels);
+
+	bool empty() const noexcept {
+		return expired_ == nullptr && pending_ == 0;
+	}
+
+	std::size_t size() const noexcept {
+		return pending_ + expired_count_;
+	}
+
+	/** Queue @a n at n.due_, straight to the expired list when it is not in the future. */
+	void insert(node &n) noexcept {
+		place(n);
+	}
+
+	/** Take @a n out, false if it was not queued (already popped). */
+	bool remove(node &n) noexcept {
+		if (!n.queued_) {
+			return false;
+		}
+		if (n.level_ == expired_level) {
+			unlink(expired_, n);
+			expired_count_ -= 1;
+		} else {
+			auto &head = wheel_[n.level_][n.slot_];
+			unlink(head, n);
+			if (head == nullptr) {
+				occupied_[n.level_] &= ~(uint64_t{1} << n.slot_);
+			}
+			pending_ -= 1;
+		}
+		n.queued_ = false;
+		return true;
+	}
+
+	/** Advance to @a now and pop one expired timer, nullptr when none is due. */
+	node *pop_due(time_point now) noexcept {
+		advance(tick_of(now));
+		auto *n = expired_;
+		if (n != nullptr) {
+			unlink(expired_, *n);
+			expired_count_ -= 1;
+			n->queued_ = false;
+		}
+		return n;
+	}
+
+	/** Lower bound of the next expiry, to program the wake-up; nothing when empty.
+	 *
+	 * Exact when the earliest timer sits in level 0, otherwise the start of
+	 * the upper slot holding it: waking up then only spreads the slot.
+	 */
+	std::optional<time_point> next_expiry() const noexcept {
+		if (expired_ != nullptr) {
+			return time_point{duration{int64_t(now_)}};
+		}
+		if (pending_ == 0) {
+			return std::nullopt;
+		}
+		return time_point{duration{int64_t(next_boundary())}};
+	}
+
+private:
+	static constexpr uint8_t expired_level = Levels;
+	static constexpr uint64_t slot_mask = slots - 1;
+	static constexpr uint64_t no_boundary = ~uint64_t{0};
+
+	std::array<std::array<node *, slots>, Levels> wheel_{};
+	std::array<uint64_t, Levels> occupied_{};
+	node *expired_ = nullptr;
+	std::size_t pending_ = 0;
+	std::size_t expired_count_ = 0;
+	uint64_t now_ = 0; ///< last tick advanced to, all slots up to it are spread or expired
+
+	static uint64_t tick_of(time_point tp) noexcept {
+		auto const count = tp.time_since_epoch().count();
+		return count < 0 ? 0 : uint64_t(count);
+	}
+
+	static constexpr uint64_t slot_number(uint64_t tick, std::size_t level) noexcept {
+		return tick >> (level * SlotBits);
+	}
+
+	static void append(node *&head, node &n) noexcept {
+		n.next_ = nullptr;
+		if (head == nullptr) {
+			head = &n;
+			n.prev_ = &n;
+		} else {
+			auto *tail = head->prev_;
+			tail->next_ = &n;
+			n.prev_ = tail;
+			head->prev_ = &n;
+		}
+	}
+
+	static void unlink(node *&head, node &n) noexcept {
+		if (&n == head) {
+			head = n.next_;
+			if (head != nullptr) {
+				head->prev_ = n.prev_;
+			}
+		} else {
+			n.prev_->next_ = n.next_;
+			if (n.next_ != nullptr) {
+				n.next_->prev_ = n.prev_;
+			} else {
+				head->prev_ = n.prev_;
+			}
+		}
+		n.next_ = n.prev_ = nullptr;
+	}
+
+	/** Put @a n in the lowest level whose window, the next slots-1 slots, holds its due tick. */
+	void place(node &n) noexcept {
+		n.queued_ = true;
+		auto const due = tick_of(n.due_);
+		if (due <= now_) {
+			n.level_ = expired_level;
+			append(expired_, n);
+			expired_count_ += 1;
+			return;
+		}
+		std::size_t level = 0;
+		uint64_t number = due;
+		while (number - slot_number(now_, level) >= slots) {
+			if (level + 1 == Levels) {
+				number = slot_number(now_, level) + slot_mask; // farthest slot, placed again later
+				break;
+			}
+			level += 1;
+			number = slot_number(due, level);
+		}
+		n.level_ = uint8_t(level);
+		n.slot_ = uint8_t(number & slot_mask);
+		append(wheel_[level][n.slot_], n);
+		occupied_[level] |= uint64_t{1} << n.slot_;
+		pending_ += 1;
+	}
+
+	/** @a bits turned so that bit @a first comes at position 0. */
+	static constexpr uint64_t rotate(uint64_t bits, std::size_t first) noexcept {
+		if constexpr (slots == 64) {
+			return std::rotr(bits, int(first));
+		} else {
+			return ((bits >> first) | (bits << (slots - first))) & ((uint64_t{1} << slots) - 1);
+		}
+	}
+
+	/** First tick after now_ where an occupied slot opens. */
+	uint64_t next_boundary() const noexcept {
+		uint64_t boundary = no_boundary;
+		for (std::size_t level = 0; level < Levels; ++level) {
+			auto const bits = occupied_[level];
+			if (bits == 0) {
+				continue;
+			}
+			// slot windows start right after the current slot, which is always empty
+			auto const current = slot_number(now_, level);
+			auto const first = std::size_t((current + 1) & slot_mask);
+			auto const number = current + 1 + uint64_t(std::countr_zero(rotate(bits, first)));
+			auto const start = number << (level * SlotBits);
+			if (start < boundary) {
+				boundary = start;
+			}
+		}
+		return boundary;
+	}
+
+	void advance(uint64_t target) noexcept {
+		while (now_ < target) {
+			auto const boundary = pending_ == 0 ? no_boundary : next_boundary();
+			if (boundary > target) {
+				now_ = target;
+				return;
+			}
+			now_ = boundary;
+			// upper slots first: what they spread lands in slots that open later
+			for (std::size_t level = Levels; level-- > 1;) {
+				if ((now_ & ((uint64_t{1} << (level * SlotBits)) - 1)) != 0) {
+					continue;
+				}
+				auto const slot = std::size_t(slot_number(now_, level) & slot_mask);
+				auto *n = std::exchange(wheel_[level][slot], nullptr);
+				occupied_[level] &= ~(uint64_t{1} << slot);
+				while (n != nullptr) {
+					auto *next = n->next_;
+					pending_ -= 1;
+					place(*n);
+					n = next;
+				}
+			}
+			auto const slot = std::size_t(now_ & slot_mask);
+			auto *n = std::exchange(wheel_[0][slot], nullptr);
+			occupied_[0] &= ~(uint64_t{1} << slot);
+			while (n != nullptr) {
+				auto *next = n->next_;
+				pending_ -= 1;
+				n->level_ = expired_level;
+				append(expired_, *n);
+				expired_count_ += 1;
+				n = next;
+			}
+		}
+	}
+};
+}
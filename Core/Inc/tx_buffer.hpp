@@ -0,0 +1,176 @@
+/** @file tx_buffer.hpp
+ *
+ * @date Oct 17, 2026
+ * @author Sylvain Garcia
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string_view>
+
+namespace stm32 {
+
+/** Ping-pong transmit buffer coalescing small writes into IN transfers.
+ *
+ * One half is on the wire while a single producer appends whole writes to
+ * the other one. The holder of the endpoint swaps them once the previous
+ * transfer completed, so the producer never waits for the peripheral.
+ *
+ * The filling half, its size and its write count are packed in one 32-bit
+ * word. A producer racing with a swap loses its compare-and-swap and copies
+ * again into the new half; the bytes it wrote past the end of the batch
+ * being sent are never transmitted.
+ *
+ * A batch whose transfer could not start is given back with retry() and
+ * returned again by the next swap(), the producer keeps filling the other
+ * half meanwhile.
+ */
+template <std::size_t HalfSize>
+class tx_double_buffer {
+	static_assert(HalfSize < 0x10000, "tx_double_buffer sizes are 16-bit");
+
+	static constexpr uint32_t half_bit = 1u << 31;
+
+	static constexpr uint16_t size(uint32_t state) noexcept {
+		return uint16_t(state);
+	}
+
+	static constexpr uint16_t writes(uint32_t state) noexcept {
+		return uint16_t((state & ~half_bit) >> 16);
+	}
+
+	static constexpr std::size_t half(uint32_t state) noexcept {
+		return state & half_bit ? 1 : 0;
+	}
+
+public:
+
+	/** Filled half handed to the endpoint. */
+	struct batch {
+		std::string_view data;
+		uint16_t writes; ///< writes coalesced in this batch
+	};
+
+	/** @a storage holds both halves, 2 * HalfSize bytes. */
+	explicit constexpr tx_double_buffer(uint8_t *storage) noexcept:
+		storage_{storage} {
+	}
+
+	static constexpr std::size_t half_size() noexcept {
+		return HalfSize;
+	}
+
+	// producer side
+
+	/** Append @a data as a whole, false (and counted as dropped) when it does not fit. */
+	bool push(std::string_view data) noexcept {
+		return push(std::span{&data, 1});
+	}
+
+	/** Append @a fragments back to back as a single write. */
+	bool push(std::span<const std::string_view> fragments, bool count_drop = true) noexcept {
+		std::size_t total = 0;
+		for (auto fragment : fragments) {
+			total += fragment.size();
+		}
+		return emplace(total, [fragments](char *out) noexcept {
+			for (auto fragment : fragments) {
+				std::memcpy(out, fragment.data(), fragment.size());
+				out += fragment.size();
+			}
+			return out;
+		}, count_drop);
+	}
+
+	/** Let @a write produce a write of at most @a max_size bytes in place.
+	 *
+	 * @a write gets where to write and returns the end of what it wrote. It
+	 * is called again when racing with a swap, so it must only depend on its
+	 * captures.
+	 */
+	template <typename Writer>
+	bool emplace(std::size_t max_size, Writer &&write, bool count_drop = true) noexcept {
+		auto state = state_.load(std::memory_order_acquire);
+		while (true) {
+			if (max_size > HalfSize - size(state)) {
+				if (count_drop) {
+					dropped_.fetch_add(1, std::memory_order_relaxed);
+				}
+				return false;
+			}
+			auto *const out = reinterpret_cast<char *>(storage_ + half(state) * HalfSize + size(state));
+			auto const written = std::size_t(write(out) - out);
+			auto const next = (state & half_bit)
+							| uint32_t(uint16_t(writes(state) + 1) & 0x7FFF) << 16
+							| uint32_t(size(state) + written);
+			if (state_.compare_exchange_weak(state, next, std::memory_order_acq_rel)) {
+				return true;
+			}
+		}
+	}
+
+	// endpoint side, only once the previous batch is off the wire
+
+	/** Take the filling half and start filling the other one, empty when nothing is queued.
+	 *
+	 * The batch given back with retry(), if any, comes first and nothing is swapped.
+	 */
+	batch swap() noexcept {
+		if (auto const held = held_.exchange(0, std::memory_order_acq_rel); size(held) != 0) {
+			return batch_of(held);
+		}
+		auto state = state_.load(std::memory_order_acquire);
+		while (size(state) != 0) {
+			if (state_.compare_exchange_weak(state, (state ^ half_bit) & half_bit, std::memory_order_acq_rel)) {
+				return batch_of(state);
+			}
+		}
+		return {{}, 0};
+	}
+
+	/** Give back @a sent, last returned by swap(), whose transfer could not start. */
+	void retry(batch sent) noexcept {
+		auto const offset = reinterpret_cast<const uint8_t *>(sent.data.data()) - storage_;
+		held_.store((offset < std::ptrdiff_t(HalfSize) ? 0 : half_bit)
+					| uint32_t(sent.writes) << 16
+					| uint32_t(sent.data.size()), std::memory_order_release);
+	}
+
+	/** Forget whatever is queued and fill the first half again, on class de-init.
+	 *
+	 * The writes lost are counted as dropped.
+	 */
+	void reset() noexcept {
+		auto const held = held_.exchange(0, std::memory_order_acq_rel);
+		auto const state = state_.exchange(0, std::memory_order_acq_rel);
+		dropped_.fetch_add(writes(held) + writes(state), std::memory_order_relaxed);
+	}
+
+	// any side
+
+	/** Bytes queued, a batch waiting for retry included. */
+	std::size_t pending() const noexcept {
+		return size(state_.load(std::memory_order_acquire)) + size(held_.load(std::memory_order_acquire));
+	}
+
+	/** Number of writes that did not fit. */
+	std::size_t dropped() const noexcept {
+		return dropped_.load(std::memory_order_relaxed);
+	}
+
+private:
+	batch batch_of(uint32_t state) const noexcept {
+		return {{reinterpret_cast<const char *>(storage_ + half(state) * HalfSize), size(state)}, writes(state)};
+	}
+
+	uint8_t *const storage_;
+	std::atomic<uint32_t> state_{0};
+	std::atomic<uint32_t> held_{0}; ///< batch given back by retry(), same packing as state_
+	std::atomic<std::size_t> dropped_{0};
+};
+}
@@ -6,62 +6,603 @@
 
 #pragma once
 
+#include <cycle_counter.hpp>
+#include <history_buffer.hpp>
 #include <io_operation_base.hpp>
+#include <line_buffer.hpp>
+#include <packet_pool.hpp>
+#include <static_format.hpp>
+#include <tx_buffer.hpp>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string_view>
 #include <system_error>
+#include <utility>
+
+extern "C" uint8_t UserTxBufferFS[];
+extern "C" uint8_t UserTxBufferDataFS[];
 
 namespace stm32 {
 
-class usb {
+/** Command channel: the CDC ACM function, interfaces 0 and 1.
+ *
+ * The host reports an open port with DTR, output is held back while it is low.
+ */
+struct usb_command_channel {
+	static constexpr bool has_line_state = true;
+	static constexpr size_t history_size = 512;
+
+	static constexpr uint8_t *tx_storage() noexcept {
+		return UserTxBufferFS;
+	}
+};
+
+/** Bulk channel: the CDC data interface 2, see usbd_composite.c.
+ *
+ * No communication interface, hence no line state: always considered open.
+ */
+struct usb_data_channel {
+	static constexpr bool has_line_state = false;
+	static constexpr size_t history_size = 0;
+
+	static constexpr uint8_t *tx_storage() noexcept {
+		return UserTxBufferDataFS;
+	}
+};
+
+/** One CDC channel of the composite device.
+ *
+ * Each channel has its own buffers and interrupt bindings, resolved at
+ * compile time from @a Channel; see usb and usb_data.
+ */
+template <typename Channel>
+class basic_usb {
 
 public:
 
-	inline static void (*notify_)(void *self, uint8_t *data, size_t size) = nullptr;
-	inline static void *notify_self_ = nullptr;
+	static constexpr size_t max_packet_size = 64;
+	static constexpr size_t rx_pool_size = 8;
+	static constexpr size_t max_line_length = 128;
+	static constexpr size_t tx_buffer_size = 2048; ///< APP_TX_DATA_SIZE
+
+	using rx_pool = packet_pool<rx_pool_size, max_packet_size>;
+
+	/** Receive buffers, the OUT endpoint is armed on one of them at a time. */
+	inline static rx_pool rx_pool_{};
+
+	/** Interrupt events operations can wait for. */
+	struct rx_event {};
+	struct sof_event {};
+	struct tx_event {};
+	struct stream_sof_event {}; ///< start of frame, for stream() retries
+	struct host_event {};       ///< DTR changed
+
+	using rx_binding = isr_binding<basic_usb, rx_event>;
+	using sof_binding = isr_binding<basic_usb, sof_event>;
+	using tx_binding = isr_binding<basic_usb, tx_event>;
+	using stream_sof_binding = isr_binding<basic_usb, stream_sof_event>;
+	using host_binding = isr_binding<basic_usb, host_event>;
+
+	/** Outcome of handing a transfer to the IN endpoint. */
+	enum class tx_status {
+		ok,
+		busy, ///< a previous transfer is still in flight
+		fail,
+	};
+
+	/** Set while a transfer started by transmit() is in flight. */
+	inline static std::atomic<bool> tx_busy_{false};
+
+	/** Number of tx_reset() calls, transmit operations fail when it changes under them. */
+	inline static std::atomic<uint32_t> tx_resets_{0};
+
+	/** Writes waiting for the next flush, both halves of the channel transmit buffer, see write(). */
+	inline static tx_double_buffer<tx_buffer_size / 2> tx_buffer_{Channel::tx_storage()};
+
+	/** Coalescing of write() calls, see tx_stats(). */
+	struct tx_flush_stats {
+		size_t flushes;
+		size_t writes;
+		uint16_t last_coalesced; ///< writes sent by the last flush
+		uint16_t max_coalesced;
+	};
+
+	inline static tx_flush_stats tx_stats_{};
+
+	/** Start-of-frame counter, one frame per millisecond on a full-speed bus. */
+	inline static std::atomic<uint32_t> frames_{0};
+
+	/** DTR as last set by the host, see host_connected(). */
+	inline static std::atomic<bool> host_connected_{!Channel::has_line_state};
+	inline static std::atomic<bool> replay_pending_{false};
+
+	/** What write() and print() recorded while no host was listening, main loop only. */
+	inline static history_buffer<Channel::history_size> history_{};
+
+	/** print() output on its way to the history, main loop only; unused without line state. */
+	inline static std::array<char, Channel::has_line_state ? tx_buffer_size / 2 : 0> print_scratch_{};
+
+	/** Move-only ownership of one received packet.
+	 *
+	 * The buffer goes back to the pool when the lease is destroyed, which may
+	 * re-arm the endpoint if it was left NAKing. Leases are released by the
+	 * consumer of the receive path, from the main loop or from the OTG_FS
+	 * interrupt, see release().
+	 */
+	class rx_lease {
+		uint8_t index_ = rx_pool::no_slot;
+
+	public:
+		rx_lease() noexcept = default;
+
+		explicit rx_lease(uint8_t index) noexcept:
+			index_{index} {
+		}
+
+		rx_lease(rx_lease &&other) noexcept:
+			index_{std::exchange(other.index_, rx_pool::no_slot)} {
+		}
+
+		rx_lease &operator=(rx_lease &&other) noexcept {
+			if (this != &other) {
+				reset();
+				index_ = std::exchange(other.index_, rx_pool::no_slot);
+			}
+			return *this;
+		}
+
+		~rx_lease() {
+			reset();
+		}
+
+		void reset() noexcept {
+			if (index_ != rx_pool::no_slot) {
+				release(std::exchange(index_, rx_pool::no_slot));
+			}
+		}
+
+		std::string_view view() const noexcept {
+			if (index_ == rx_pool::no_slot) {
+				return {};
+			}
+			auto &slot = rx_pool_[index_];
+			return {reinterpret_cast<const char*>(slot.data.data()), slot.size};
+		}
+
+		size_t size() const noexcept {
+			return view().size();
+		}
+
+		/** Cycle stamp taken in the USB interrupt when the packet arrived. */
+		cycle_counter::stamp received_at() const noexcept {
+			return index_ == rx_pool::no_slot ? 0 : rx_pool_[index_].stamp;
+		}
+
+		explicit operator bool() const noexcept {
+			return index_ != rx_pool::no_slot;
+		}
+	};
+
+	/** A line returned by read_line(). */
+	struct rx_line {
+		std::string_view text;
+		cycle_counter::stamp received_at; ///< stamp of the packet completing the line
+
+		operator std::string_view() const noexcept {
+			return text;
+		}
+
+		size_t size() const noexcept {
+			return text.size();
+		}
+	};
+
+	/** Byte count returned by read_some() and receive_at_least(). */
+	struct rx_count {
+		size_t size;
+		cycle_counter::stamp received_at; ///< stamp of the last packet copied
+	};
+
+	/** Latencies in core cycles, see latency(). */
+	struct latency_stats {
+		cycle_counter::stamp last_isr_to_dispatch;
+		cycle_counter::stamp max_isr_to_dispatch;
+		cycle_counter::stamp last_dispatch_to_tx;
+		cycle_counter::stamp max_dispatch_to_tx;
+	};
+
+	inline static latency_stats latency_{};
+	inline static cycle_counter::stamp dispatched_at_ = 0;
+
+	/** Set by dispatched() until the next write() is queued, main loop only. */
+	inline static bool dispatch_pending_ = false;
+
+	/** Set once that write() is queued, until the flush handing it to the hardware. */
+	inline static std::atomic<bool> dispatch_queued_{false};
+
+	/** Record that data received at @a received_at reaches its handler.
+	 *
+	 * Called by the application where the command is handed over, typically
+	 * on the main loop right after the hop from the receive interrupt, so
+	 * that ISR-to-dispatch includes the scheduling delay.
+	 */
+	static void dispatched(cycle_counter::stamp received_at) noexcept {
+		dispatched_at_ = cycle_counter::now();
+		auto const elapsed = cycle_counter::elapsed(received_at, dispatched_at_);
+		latency_.last_isr_to_dispatch = elapsed;
+		if (elapsed > latency_.max_isr_to_dispatch) {
+			latency_.max_isr_to_dispatch = elapsed;
+		}
+		dispatch_pending_ = true;
+	}
+
+	/** Make the claimed @a op wait for the next packet.
+	 *
+	 * Completes it right away if a packet got queued in the meantime.
+	 */
+	template <typename Op>
+	static void wait_packet(Op &op) noexcept {
+		rx_binding::bind(op);
+		if (op.resume_pending() && rx_pool_.has_ready()) {
+			// data may have been queued while nobody was listening
+			if (auto *waiter = rx_binding::claim()) {
+				waiter->complete();
+			}
+		}
+	}
 
 	struct rx_sender {
 
 	    template <typename Receiver>
-		struct operation : public io_operation_base<operation, Receiver> {
+		struct operation : public io_operation_base<operation, Receiver>,
+						   public isr_operation<operation<Receiver>, basic_usb, rx_event> {
 
 	    	rx_sender &sender_;
 
 			operation(rx_sender &sender, Receiver &&r) noexcept:
-				io_operation_base<operation, Receiver>{(Receiver &&)r},
+				io_operation_base<operation, Receiver>{(Receiver &&)r, sender.deadline_},
+				sender_{sender} {
+		  	}
+
+			void start_io() noexcept {
+				wait_packet(*this);
+			}
+
+			void on_isr(rx_event) noexcept {
+				if (!this->try_claim()) {
+					// whoever holds the operation will look at the pool again
+					rx_binding::bind(*this);
+					return;
+				}
+				rx_lease lease{rx_pool_.acquire()};
+				std::move(*this).set_value(std::move(lease));
+			}
+
+            void stop_io() noexcept {
+				rx_binding::unbind(*this);
+            }
+		};
+
+	    template <
+	        template <typename...> class Variant,
+	        template <typename...> class Tuple>
+	    using value_types = Variant<Tuple<rx_lease>>;
+
+	    template <template <typename...> class Variant>
+	    using error_types = Variant<std::error_code, std::exception_ptr>;
+
+	    static constexpr bool sends_done = true;
+
+	    basic_usb &driver_;
+	    io_deadline deadline_;
+
+	    rx_sender(basic_usb &driver, io_deadline deadline) :
+	    	driver_{driver},
+			deadline_{deadline} {
+	    }
+
+	    template <typename Receiver>
+	    operation<std::remove_cvref_t<Receiver>> connect(Receiver&& r) && {
+	      return operation<std::remove_cvref_t<Receiver>>{*this, (Receiver &&) r};
+	    }
+	};
+
+	struct line_sender {
+
+	    template <typename Receiver>
+		struct operation : public io_operation_base<operation, Receiver>,
+						   public isr_operation<operation<Receiver>, basic_usb, rx_event> {
+
+	    	line_sender &sender_;
+
+			operation(line_sender &sender, Receiver &&r) noexcept:
+				io_operation_base<operation, Receiver>{(Receiver &&)r, sender.deadline_},
+				sender_{sender} {
+		  	}
+
+			void start_io() noexcept {
+				if (!try_complete()) {
+					wait_packet(*this);
+				}
+			}
+
+			void on_isr(rx_event) noexcept {
+				if (!this->try_claim()) {
+					rx_binding::bind(*this);
+					return;
+				}
+				if (!try_complete()) {
+					wait_packet(*this);
+				}
+			}
+
+            void stop_io() noexcept {
+				rx_binding::unbind(*this);
+            }
+
+		private:
+
+			// feeds queued packets into the reassembly buffer until a line is complete
+			bool try_complete() noexcept {
+				auto &driver = sender_.driver_;
+				using status = typename decltype(driver.lines_)::status;
+				while (true) {
+					auto [st, line] = driver.lines_.next(sender_.policy_);
+					switch (st) {
+					case status::line:
+					case status::truncated:
+						std::move(*this).set_value(rx_line{line, driver.partial_received_at_});
+						return true;
+					case status::overflow:
+						std::move(*this).set_error(std::make_error_code(std::errc::message_size));
+						return true;
+					case status::none:
+						break;
+					}
+					auto data = driver.peek();
+					if (data.empty()) {
+						return false;
+					}
+					driver.consume(driver.lines_.append(data));
+				}
+			}
+		};
+
+	    template <
+	        template <typename...> class Variant,
+	        template <typename...> class Tuple>
+	    using value_types = Variant<Tuple<rx_line>>;
+
+	    template <template <typename...> class Variant>
+	    using error_types = Variant<std::error_code, std::exception_ptr>;
+
+	    static constexpr bool sends_done = true;
+
+	    basic_usb &driver_;
+	    line_overflow policy_;
+	    io_deadline deadline_;
+
+	    line_sender(basic_usb &driver, line_overflow policy, io_deadline deadline) :
+	    	driver_{driver},
+			policy_{policy},
+			deadline_{deadline} {
+	    }
+
+	    template <typename Receiver>
+	    operation<std::remove_cvref_t<Receiver>> connect(Receiver&& r) && {
+	      return operation<std::remove_cvref_t<Receiver>>{*this, (Receiver &&) r};
+	    }
+	};
+
+	struct at_least_sender {
+
+	    template <typename Receiver>
+		struct operation : public io_operation_base<operation, Receiver>,
+						   public isr_operation<operation<Receiver>, basic_usb, rx_event>,
+						   public isr_operation<operation<Receiver>, basic_usb, sof_event> {
+
+	    	at_least_sender &sender_;
+	    	size_t filled_ = 0;
+	    	uint32_t last_frame_ = 0;
+
+			operation(at_least_sender &sender, Receiver &&r) noexcept:
+				io_operation_base<operation, Receiver>{(Receiver &&)r, sender.deadline_},
+				sender_{sender} {
+		  	}
+
+			void start_io() noexcept {
+				if (!try_complete()) {
+					wait();
+				}
+			}
+
+			// packet received
+			void on_isr(rx_event) noexcept {
+				if (!this->try_claim()) {
+					rx_binding::bind(*this);
+					return;
+				}
+				if (try_complete()) {
+					return;
+				}
+				wait();
+			}
+
+			// start of frame, both events come from the same interrupt
+			void on_isr(sof_event) noexcept {
+				if (!this->try_claim()) {
+					sof_binding::bind(*this);
+					return;
+				}
+				auto const idle = frames_.load(std::memory_order_relaxed) - last_frame_;
+				if (idle < uint32_t(sender_.idle_gap_.count())) {
+					sof_binding::bind(*this);
+					this->resume_pending();
+					return;
+				}
+				rx_binding::unbind(*this);
+				std::move(*this).set_value(rx_count{filled_, sender_.driver_.partial_received_at_});
+			}
+
+            // bytes already copied are delivered, nothing received means done
+            bool stop_io() noexcept {
+				rx_binding::unbind(*this);
+				sof_binding::unbind(*this);
+				if (filled_ == 0) {
+					return false;
+				}
+				std::move(*this).set_value(rx_count{filled_, sender_.driver_.partial_received_at_});
+				return true;
+            }
+
+		private:
+
+			void wait() noexcept {
+				// idle detection only starts with the first byte
+				if (filled_ != 0 && !sof_binding::bound(*this)) {
+					sof_binding::bind(*this);
+				}
+				wait_packet(*this);
+			}
+
+			// copies queued packets into the caller buffer
+			bool try_complete() noexcept {
+				auto &driver = sender_.driver_;
+				auto buffer = sender_.buffer_;
+				auto const before = filled_;
+				while (filled_ < buffer.size()) {
+					auto data = driver.peek();
+					if (data.empty()) {
+						break;
+					}
+					auto const count = std::min(data.size(), buffer.size() - filled_);
+					std::memcpy(buffer.data() + filled_, data.data(), count);
+					filled_ += count;
+					driver.consume(count);
+				}
+				if (filled_ != before) {
+					// the idle gap counts from the last byte taken, queued ones included
+					last_frame_ = frames_.load(std::memory_order_relaxed);
+				}
+				if (filled_ < sender_.count_ && filled_ < buffer.size()) {
+					return false;
+				}
+				sof_binding::unbind(*this);
+				std::move(*this).set_value(rx_count{filled_, driver.partial_received_at_});
+				return true;
+			}
+		};
+
+	    template <
+	        template <typename...> class Variant,
+	        template <typename...> class Tuple>
+	    using value_types = Variant<Tuple<rx_count>>;
+
+	    template <template <typename...> class Variant>
+	    using error_types = Variant<std::error_code, std::exception_ptr>;
+
+	    static constexpr bool sends_done = true;
+
+	    basic_usb &driver_;
+	    std::span<std::byte> buffer_;
+	    size_t count_;
+	    std::chrono::milliseconds idle_gap_;
+	    io_deadline deadline_;
+
+	    template <typename Receiver>
+	    operation<std::remove_cvref_t<Receiver>> connect(Receiver&& r) && {
+	      return operation<std::remove_cvref_t<Receiver>>{*this, (Receiver &&) r};
+	    }
+	};
+
+	struct read_some_sender {
+
+	    template <typename Receiver>
+		struct operation : public io_operation_base<operation, Receiver>,
+						   public isr_operation<operation<Receiver>, basic_usb, rx_event> {
+
+	    	read_some_sender &sender_;
+
+			operation(read_some_sender &sender, Receiver &&r) noexcept:
+				io_operation_base<operation, Receiver>{(Receiver &&)r, sender.deadline_},
 				sender_{sender} {
-				sender.driver_.notify_self_ = this;
-				sender.driver_.notify_ = &operation::on_complete;
 		  	}
 
-			static void on_complete(void *self, uint8_t *data, size_t size) {
-				auto me = static_cast<operation*>(self);
-				me->sender_.driver_.notify_self_ = nullptr;
-				me->sender_.driver_.notify_ = nullptr;
+			void start_io() noexcept {
+				if (!try_complete()) {
+					wait_packet(*this);
+				}
+			}
 
-				std::move(*me).set_value(std::string_view{reinterpret_cast<char*>(data), size});
+			void on_isr(rx_event) noexcept {
+				if (!this->try_claim()) {
+					rx_binding::bind(*this);
+					return;
+				}
+				if (!try_complete()) {
+					wait_packet(*this);
+				}
 			}
 
             void stop_io() noexcept {
-				sender_.driver_.notify_self_ = nullptr;
-				sender_.driver_.notify_ = nullptr;
-				std::move(*this).set_value(std::string_view{nullptr, 0u});
+				rx_binding::unbind(*this);
             }
+
+		private:
+
+			// scatters queued packets into the caller buffers
+			bool try_complete() noexcept {
+				auto &driver = sender_.driver_;
+				size_t total = 0;
+				for (auto buffer : sender_.buffers()) {
+					size_t filled = 0;
+					while (filled < buffer.size()) {
+						auto data = driver.peek();
+						if (data.empty()) {
+							break;
+						}
+						auto const count = std::min(data.size(), buffer.size() - filled);
+						std::memcpy(buffer.data() + filled, data.data(), count);
+						filled += count;
+						driver.consume(count);
+					}
+					total += filled;
+					if (filled < buffer.size()) {
+						break;
+					}
+				}
+				if (total == 0) {
+					return false;
+				}
+				std::move(*this).set_value(rx_count{total, driver.partial_received_at_});
+				return true;
+			}
 		};
 
 	    template <
 	        template <typename...> class Variant,
 	        template <typename...> class Tuple>
-	    using value_types = Variant<Tuple<std::string_view>>;
+	    using value_types = Variant<Tuple<rx_count>>;
 
 	    template <template <typename...> class Variant>
 	    using error_types = Variant<std::error_code, std::exception_ptr>;
 
 	    static constexpr bool sends_done = true;
 
-	    usb &driver_;
+	    basic_usb &driver_;
+	    std::span<std::byte> single_;
+	    std::span<const std::span<std::byte>> buffers_;
+	    io_deadline deadline_;
 
-	    rx_sender(usb &driver) :
-	    	driver_{driver} {
+	    std::span<const std::span<std::byte>> buffers() const noexcept {
+	    	return buffers_.empty() ? std::span<const std::span<std::byte>>{&single_, 1} : buffers_;
 	    }
 
 	    template <typename Receiver>
@@ -70,16 +611,1057 @@ public:
 	    }
 	};
 
-	auto receive() {
-		return rx_sender{*this};
+	struct write_sender {
+
+	    template <typename Receiver>
+		struct operation : public io_operation_base<operation, Receiver>,
+						   public isr_operation<operation<Receiver>, basic_usb, tx_event> {
+
+	    	write_sender &sender_;
+	    	uint32_t tx_epoch_ = 0;
+	    	bool sent_ = false;
+	    	std::atomic<bool> stopped_{false};
+
+			operation(write_sender &sender, Receiver &&r) noexcept:
+				io_operation_base<operation, Receiver>{(Receiver &&)r, sender.deadline_},
+				sender_{sender} {
+		  	}
+
+			void start_io() noexcept {
+				if (!host_connected()) {
+					history_.push(sender_.data_);
+					std::move(*this).set_value(sender_.data_.size());
+					return;
+				}
+				replay();
+				tx_epoch_ = tx_resets_.load(std::memory_order_acquire);
+				if (!try_send()) {
+					wait();
+				}
+			}
+
+			// end of a transfer, ours or the one we were waiting behind
+			void on_isr(tx_event) noexcept {
+				if (!this->try_claim()) {
+					if (stopped_.load(std::memory_order_acquire)) {
+						// stopped while in flight, the stop path handed the operation over
+						std::move(*this).set_done();
+						return;
+					}
+					tx_binding::bind(*this);
+					return;
+				}
+				if (tx_reset_since(tx_epoch_)) {
+					std::move(*this).set_error(std::make_error_code(std::errc::connection_reset));
+				} else if (sent_) {
+					std::move(*this).set_value(sender_.data_.size());
+				} else if (!try_send()) {
+					wait();
+				}
+			}
+
+			// the hardware may still read the buffer, done is only sent once it is released
+			bool stop_io() noexcept {
+				if (!sent_) {
+					tx_binding::unbind(*this);
+					return false;
+				}
+				stopped_.store(true, std::memory_order_release);
+				if (!tx_busy_.load(std::memory_order_acquire) && tx_binding::unbind(*this)) {
+					return false;
+				}
+				return true;
+			}
+
+		private:
+
+			void wait() noexcept {
+				tx_binding::bind(*this);
+				if (this->resume_pending() && !tx_busy_.load(std::memory_order_acquire) && tx_buffer_.pending() == 0) {
+					// the transfer ended before we were bound
+					if (auto *waiter = tx_binding::claim()) {
+						waiter->complete();
+					}
+				}
+			}
+
+			// @return true when completed
+			bool try_send() noexcept {
+				if (tx_buffer_.pending() != 0) {
+					// queued writes go first, we are fired again once they are on the wire
+					flush();
+					return false;
+				}
+				switch (transmit(sender_.data_)) {
+				case tx_status::ok:
+					sent_ = true;
+					return false;
+				case tx_status::busy:
+					return false;
+				case tx_status::fail:
+					break;
+				}
+				std::move(*this).set_error(std::make_error_code(std::errc::io_error));
+				return true;
+			}
+		};
+
+	    template <
+	        template <typename...> class Variant,
+	        template <typename...> class Tuple>
+	    using value_types = Variant<Tuple<size_t>>;
+
+	    template <template <typename...> class Variant>
+	    using error_types = Variant<std::error_code, std::exception_ptr>;
+
+	    static constexpr bool sends_done = true;
+
+	    basic_usb &driver_;
+	    std::string_view data_;
+	    io_deadline deadline_;
+
+	    template <typename Receiver>
+	    operation<std::remove_cvref_t<Receiver>> connect(Receiver&& r) && {
+	      return operation<std::remove_cvref_t<Receiver>>{*this, (Receiver &&) r};
+	    }
+	};
+
+	struct writev_sender {
+
+	    template <typename Receiver>
+		struct operation : public io_operation_base<operation, Receiver>,
+						   public isr_operation<operation<Receiver>, basic_usb, tx_event> {
+
+	    	/** Staging retried on the main loop, the only producer of tx_buffer_. */
+	    	struct stage_retry : io_completions::node {
+	    		operation *op_;
+	    	};
+
+	    	writev_sender &sender_;
+	    	uint32_t tx_epoch_ = 0;
+	    	stage_retry retry_{};
+
+			operation(writev_sender &sender, Receiver &&r) noexcept:
+				io_operation_base<operation, Receiver>{(Receiver &&)r, sender.deadline_},
+				sender_{sender} {
+				retry_.deliver_ = [](io_completions::node &n) noexcept {
+					auto &op = *static_cast<stage_retry &>(n).op_;
+					if (!op.try_stage()) {
+						op.wait();
+					}
+				};
+				retry_.op_ = this;
+		  	}
+
+			void start_io() noexcept {
+				if (!host_connected()) {
+					size_t total = 0;
+					for (auto fragment : sender_.fragments_) {
+						history_.push(fragment);
+						total += fragment.size();
+					}
+					std::move(*this).set_value(total);
+					return;
+				}
+				replay();
+				tx_epoch_ = tx_resets_.load(std::memory_order_acquire);
+				if (!try_stage()) {
+					wait();
+				}
+			}
+
+			// a transfer ended, the half it used can be filled again
+			void on_isr(tx_event) noexcept {
+				if (!this->try_claim()) {
+					tx_binding::bind(*this);
+					return;
+				}
+				if (tx_reset_since(tx_epoch_)) {
+					std::move(*this).set_error(std::make_error_code(std::errc::connection_reset));
+					return;
+				}
+				// swap the halves here, stage from the main loop: pushing from the
+				// interrupt could overwrite a write() it preempted
+				flush();
+				io_completions::post(retry_);
+			}
+
+            void stop_io() noexcept {
+				tx_binding::unbind(*this);
+            }
+
+		private:
+
+			void wait() noexcept {
+				tx_binding::bind(*this);
+				if (this->resume_pending() && !tx_busy_.load(std::memory_order_acquire)) {
+					if (auto *waiter = tx_binding::claim()) {
+						waiter->complete();
+					}
+				}
+			}
+
+			// @return true when completed
+			bool try_stage() noexcept {
+				size_t total = 0;
+				for (auto fragment : sender_.fragments_) {
+					total += fragment.size();
+				}
+				if (total > tx_buffer_.half_size()) {
+					std::move(*this).set_error(std::make_error_code(std::errc::message_size));
+					return true;
+				}
+				if (!tx_buffer_.push(sender_.fragments_, false)) {
+					// swap the halves if the endpoint is idle and try again
+					flush();
+					if (!tx_buffer_.push(sender_.fragments_, false)) {
+						return false;
+					}
+				}
+				if (tx_buffer_.pending() >= max_packet_size) {
+					flush();
+				}
+				std::move(*this).set_value(total);
+				return true;
+			}
+		};
+
+	    template <
+	        template <typename...> class Variant,
+	        template <typename...> class Tuple>
+	    using value_types = Variant<Tuple<size_t>>;
+
+	    template <template <typename...> class Variant>
+	    using error_types = Variant<std::error_code, std::exception_ptr>;
+
+	    static constexpr bool sends_done = true;
+
+	    basic_usb &driver_;
+	    std::span<const std::string_view> fragments_;
+	    io_deadline deadline_;
+
+	    template <typename Receiver>
+	    operation<std::remove_cvref_t<Receiver>> connect(Receiver&& r) && {
+	      return operation<std::remove_cvref_t<Receiver>>{*this, (Receiver &&) r};
+	    }
+	};
+
+	/** Result of stream(). */
+	struct stream_stats {
+		size_t bytes;
+		size_t transfers;
+		size_t stalls; ///< frames the endpoint sat idle because the source had nothing
+	};
+
+	template <typename Fill>
+	struct stream_sender {
+
+	    template <typename Receiver>
+		struct operation : public io_operation_base<operation, Receiver>,
+						   public isr_operation<operation<Receiver>, basic_usb, tx_event>,
+						   public isr_operation<operation<Receiver>, basic_usb, stream_sof_event> {
+
+	    	stream_sender &sender_;
+	    	size_t remaining_;
+	    	std::array<size_t, 2> sizes_{};
+	    	uint8_t wire_ = 0;        ///< half sent next, or on the wire
+	    	uint32_t tx_epoch_ = 0;
+	    	bool owner_ = false;      ///< holds tx_busy_
+	    	bool in_flight_ = false;
+	    	std::atomic<bool> stopped_{false};
+	    	stream_stats stats_{};
+
+			operation(stream_sender &sender, Receiver &&r) noexcept:
+				io_operation_base<operation, Receiver>{(Receiver &&)r, sender.deadline_},
+				sender_{sender},
+				remaining_{sender.size_} {
+		  	}
+
+			void start_io() noexcept {
+				tx_epoch_ = tx_resets_.load(std::memory_order_acquire);
+				if (half(0).empty()) {
+					std::move(*this).set_error(std::make_error_code(std::errc::invalid_argument));
+					return;
+				}
+				// writes queued before the stream go first
+				flush();
+				if (!acquire()) {
+					wait_tx();
+					return;
+				}
+				pump();
+			}
+
+			// our transfer ended, or the endpoint became free
+			void on_isr(tx_event) noexcept {
+				if (!this->try_claim()) {
+					if (stopped_.load(std::memory_order_acquire)) {
+						release();
+						std::move(*this).set_done();
+						return;
+					}
+					tx_binding::bind(*this);
+					return;
+				}
+				if (tx_reset_since(tx_epoch_)) {
+					// tx_reset() already released the endpoint
+					owner_ = false;
+					std::move(*this).set_error(std::make_error_code(std::errc::connection_reset));
+					return;
+				}
+				if (in_flight_) {
+					in_flight_ = false;
+					sizes_[wire_] = 0;
+					wire_ ^= 1;
+				}
+				// tx_complete() released the endpoint, take it back before anybody else
+				if (!acquire()) {
+					wait_tx();
+					return;
+				}
+				pump();
+			}
+
+			// retry a source that had nothing
+			void on_isr(stream_sof_event) noexcept {
+				if (!this->try_claim()) {
+					stream_sof_binding::bind(*this);
+					return;
+				}
+				pump();
+			}
+
+			bool stop_io() noexcept {
+				stream_sof_binding::unbind(*this);
+				if (!in_flight_) {
+					tx_binding::unbind(*this);
+					release();
+					return false;
+				}
+				// the hardware still reads the caller buffer, see async_write()
+				stopped_.store(true, std::memory_order_release);
+				if (!tx_busy_.load(std::memory_order_acquire) && tx_binding::unbind(*this)) {
+					release();
+					return false;
+				}
+				return true;
+			}
+
+		private:
+
+			std::span<std::byte> half(uint8_t index) const noexcept {
+				auto const size = std::min<size_t>(sender_.buffer_.size() / 2 / max_packet_size * max_packet_size, 0xFFC0);
+				return sender_.buffer_.subspan(index * size, size);
+			}
+
+			void produce(uint8_t index) noexcept {
+				if (remaining_ == 0 || sizes_[index] != 0) {
+					return;
+				}
+				auto buffer = half(index);
+				auto const size = sender_.fill_(buffer.first(std::min(buffer.size(), remaining_)));
+				sizes_[index] = size;
+				remaining_ -= size;
+			}
+
+			bool acquire() noexcept {
+				owner_ = !tx_busy_.exchange(true, std::memory_order_acq_rel);
+				return owner_;
+			}
+
+			void release() noexcept {
+				if (std::exchange(owner_, false)) {
+					tx_busy_.store(false, std::memory_order_release);
+					flush();
+				}
+			}
+
+			void wait_tx() noexcept {
+				tx_binding::bind(*this);
+				if (this->resume_pending() && !tx_busy_.load(std::memory_order_acquire)) {
+					if (auto *waiter = tx_binding::claim()) {
+						waiter->complete();
+					}
+				}
+			}
+
+			// claimed, holding the endpoint, nothing on the wire
+			void pump() noexcept {
+				produce(wire_);
+				auto const size = sizes_[wire_];
+				if (size == 0) {
+					if (remaining_ == 0) {
+						release();
+						std::move(*this).set_value(stats_);
+						return;
+					}
+					stats_.stalls += 1;
+					stream_sof_binding::bind(*this);
+					this->resume_pending();
+					return;
+				}
+				auto const data = half(wire_).first(size);
+				if (tx_start_stream({reinterpret_cast<const char *>(data.data()), size}, remaining_ == 0) != tx_status::ok) {
+					release();
+					std::move(*this).set_error(std::make_error_code(std::errc::io_error));
+					return;
+				}
+				in_flight_ = true;
+				stats_.transfers += 1;
+				stats_.bytes += size;
+				// fill the other half while this one is on the wire
+				produce(wire_ ^ 1);
+				// tx_complete() releases the endpoint before firing, owner_ tells it was ours
+				wait_tx();
+			}
+		};
+
+	    template <
+	        template <typename...> class Variant,
+	        template <typename...> class Tuple>
+	    using value_types = Variant<Tuple<stream_stats>>;
+
+	    template <template <typename...> class Variant>
+	    using error_types = Variant<std::error_code, std::exception_ptr>;
+
+	    static constexpr bool sends_done = true;
+
+	    basic_usb &driver_;
+	    std::span<std::byte> buffer_;
+	    size_t size_;
+	    Fill fill_;
+	    io_deadline deadline_;
+
+	    template <typename Receiver>
+	    operation<std::remove_cvref_t<Receiver>> connect(Receiver&& r) && {
+	      return operation<std::remove_cvref_t<Receiver>>{*this, (Receiver &&) r};
+	    }
+	};
+
+	struct host_sender {
+
+	    template <typename Receiver>
+		struct operation : public io_operation_base<operation, Receiver>,
+						   public isr_operation<operation<Receiver>, basic_usb, host_event> {
+
+	    	host_sender &sender_;
+
+			operation(host_sender &sender, Receiver &&r) noexcept:
+				io_operation_base<operation, Receiver>{(Receiver &&)r, sender.deadline_},
+				sender_{sender} {
+		  	}
+
+			void start_io() noexcept {
+				if (host_connected() == sender_.connected_) {
+					std::move(*this).set_value();
+					return;
+				}
+				wait();
+			}
+
+			void on_isr(host_event) noexcept {
+				if (!this->try_claim()) {
+					host_binding::bind(*this);
+					return;
+				}
+				if (host_connected() == sender_.connected_) {
+					std::move(*this).set_value();
+					return;
+				}
+				wait();
+			}
+
+            void stop_io() noexcept {
+				host_binding::unbind(*this);
+            }
+
+		private:
+
+			void wait() noexcept {
+				host_binding::bind(*this);
+				if (this->resume_pending() && host_connected() == sender_.connected_) {
+					// the line changed before we were bound
+					if (auto *waiter = host_binding::claim()) {
+						waiter->complete();
+					}
+				}
+			}
+		};
+
+	    template <
+	        template <typename...> class Variant,
+	        template <typename...> class Tuple>
+	    using value_types = Variant<Tuple<>>;
+
+	    template <template <typename...> class Variant>
+	    using error_types = Variant<std::error_code, std::exception_ptr>;
+
+	    static constexpr bool sends_done = true;
+
+	    basic_usb &driver_;
+	    bool connected_;
+	    io_deadline deadline_;
+
+	    template <typename Receiver>
+	    operation<std::remove_cvref_t<Receiver>> connect(Receiver&& r) && {
+	      return operation<std::remove_cvref_t<Receiver>>{*this, (Receiver &&) r};
+	    }
+	};
+
+	/** Continuous packet stream.
+	 *
+	 * The stream registers itself once as the receive completion target and
+	 * stays registered until cleanup(), so next() only parks its operation in
+	 * the stream instead of rewiring the driver for every packet. A stream must
+	 * not be moved once next() has been called.
+	 */
+	class rx_stream : public isr_operation<rx_stream, basic_usb, rx_event> {
+
+		friend isr_operation<rx_stream, basic_usb, rx_event>;
+
+		struct next_sender {
+
+		    template <typename Receiver>
+			struct operation : public io_operation_base<operation, Receiver>,
+							   public isr_operation<operation<Receiver>, basic_usb, rx_event> {
+
+		    	rx_stream &stream_;
+
+				operation(rx_stream &stream, Receiver &&r) noexcept:
+					io_operation_base<operation, Receiver>{(Receiver &&)r},
+					stream_{stream} {
+			  	}
+
+				void start_io() noexcept {
+					stream_.attach();
+					if (!rx_pool_.has_ready()) {
+						stream_.pending_.store(this, std::memory_order_release);
+						if (!this->resume_pending() || !rx_pool_.has_ready()) {
+							return;
+						}
+						typename rx_binding::waiter *self = this;
+						if (!stream_.pending_.compare_exchange_strong(self, nullptr) || !this->try_claim()) {
+							return;
+						}
+					}
+					deliver();
+				}
+
+				void on_isr(rx_event) noexcept {
+					if (!this->try_claim()) {
+						stream_.pending_.store(this, std::memory_order_release);
+						return;
+					}
+					deliver();
+				}
+
+	            void stop_io() noexcept {
+	            	typename rx_binding::waiter *self = this;
+	            	stream_.pending_.compare_exchange_strong(self, nullptr);
+	            }
+
+			private:
+
+				void deliver() noexcept {
+					rx_lease lease{rx_pool_.acquire()};
+					std::move(*this).set_value(std::move(lease));
+				}
+			};
+
+		    template <
+		        template <typename...> class Variant,
+		        template <typename...> class Tuple>
+		    using value_types = Variant<Tuple<rx_lease>>;
+
+		    template <template <typename...> class Variant>
+		    using error_types = Variant<std::error_code, std::exception_ptr>;
+
+		    static constexpr bool sends_done = true;
+
+		    rx_stream &stream_;
+
+		    template <typename Receiver>
+		    operation<std::remove_cvref_t<Receiver>> connect(Receiver&& r) && {
+		      return operation<std::remove_cvref_t<Receiver>>{stream_, (Receiver &&) r};
+		    }
+		};
+
+		struct cleanup_sender {
+
+		    template <typename Receiver>
+			struct operation {
+		    	rx_stream &stream_;
+		    	Receiver receiver_;
+
+		    	void start() noexcept {
+		    		stream_.detach();
+		    		unifex::set_value(std::move(receiver_));
+		    	}
+			};
+
+		    template <
+		        template <typename...> class Variant,
+		        template <typename...> class Tuple>
+		    using value_types = Variant<Tuple<>>;
+
+		    template <template <typename...> class Variant>
+		    using error_types = Variant<>;
+
+		    static constexpr bool sends_done = false;
+
+		    rx_stream &stream_;
+
+		    template <typename Receiver>
+		    operation<std::remove_cvref_t<Receiver>> connect(Receiver&& r) && {
+		      return operation<std::remove_cvref_t<Receiver>>{stream_, (Receiver &&) r};
+		    }
+		};
+
+		basic_usb &driver_;
+		std::atomic<typename rx_binding::waiter *> pending_{nullptr};
+		std::atomic<bool> attached_{false};
+
+		void attach() noexcept {
+			if (!attached_.exchange(true)) {
+				rx_binding::bind(*this);
+			}
+		}
+
+		void detach() noexcept {
+			if (attached_.exchange(false)) {
+				rx_binding::unbind(*this);
+			}
+		}
+
+		// the binding is one-shot, take it back after each packet
+		void on_isr(rx_event) noexcept {
+			if (auto *op = pending_.exchange(nullptr)) {
+				op->complete();
+			}
+			if (attached_.load(std::memory_order_acquire)) {
+				rx_binding::bind(*this);
+			}
+		}
+
+	public:
+
+		explicit rx_stream(basic_usb &driver) noexcept:
+			driver_{driver} {
+		}
+
+		rx_stream(rx_stream &&other) noexcept:
+			driver_{other.driver_} {
+		}
+
+		next_sender next() noexcept {
+			return next_sender{*this};
+		}
+
+		cleanup_sender cleanup() noexcept {
+			return cleanup_sender{*this};
+		}
+	};
+
+	/** Stream of received packets, see rx_stream. */
+	rx_stream receive_stream() noexcept {
+		return rx_stream{*this};
 	}
 
-	void write(std::string_view data);
+	basic_usb() noexcept {
+		cycle_counter::enable();
+	}
+
+	/** Receive one packet.
+	 *
+	 * Completes immediately when packets are already queued, with a lease on
+	 * the buffer the packet was received in (no copy).
+	 *
+	 * Like every receive below, the operation completes with done when
+	 * @a deadline expires first, e.g. receive(100ms).
+	 */
+	auto receive(io_deadline deadline = {}) {
+		return rx_sender{*this, deadline};
+	}
+
+	/** Receive one "\r\n" terminated line, delimiter included.
+	 *
+	 * Lines may span several packets and a packet may hold several lines. The
+	 * returned view points into the reassembly buffer and stays valid until the
+	 * next read_line() is started. Lines longer than max_line_length are
+	 * handled according to @a policy.
+	 */
+	auto read_line(io_deadline deadline = {}, line_overflow policy = line_overflow::discard) {
+		return line_sender{*this, policy, deadline};
+	}
+
+	auto read_line(line_overflow policy) {
+		return line_sender{*this, policy, {}};
+	}
+
+	/** Receive into @a buffer until at least @a count bytes are there or the line is idle.
+	 *
+	 * Completes with the number of bytes written, once @a count bytes (or the
+	 * whole buffer) have been received, or once @a idle_gap elapsed without a
+	 * new packet after the first byte. Idle time is measured in USB frames, so
+	 * it only advances while the bus is not suspended. When @a deadline
+	 * expires, bytes already received are delivered as well.
+	 */
+	auto receive_at_least(std::span<std::byte> buffer, size_t count, std::chrono::milliseconds idle_gap,
+						  io_deadline deadline = {}) {
+		return at_least_sender{*this, buffer, count, idle_gap, deadline};
+	}
+
+	/** Copy whatever has been received into @a buffer.
+	 *
+	 * Completes with the number of bytes written as soon as at least one byte
+	 * is available. Bytes go straight from the receive buffer the packet
+	 * landed in to the caller storage, leftovers of a packet are kept for the
+	 * next read.
+	 */
+	auto read_some(std::span<std::byte> buffer, io_deadline deadline = {}) {
+		return read_some_sender{*this, buffer, {}, deadline};
+	}
+
+	/** Scatter variant of read_some(), buffers are filled in order. */
+	auto read_some(std::span<const std::span<std::byte>> buffers, io_deadline deadline = {}) {
+		return read_some_sender{*this, {}, buffers, deadline};
+	}
+
+	/** Number of lines that exceeded max_line_length. */
+	size_t line_overflows() const noexcept {
+		return lines_.overflows();
+	}
 
-	static void notify(uint8_t *data, size_t size) {
-		if (notify_ && notify_self_) {
-			notify_(notify_self_, data, size);
+	/** Queue a copy of @a data, false when it was dropped.
+	 *
+	 * @a data is copied into the half of the transmit buffer that is not on the
+	 * wire. Writes are coalesced and flushed on the next start of frame, on
+	 * transmit complete, or right away once a packet worth of data is queued.
+	 * @a data is dropped when the half is full, see tx_dropped().
+	 *
+	 * While no host has the port open, @a data only goes to the history
+	 * replayed on connect, see replay().
+	 */
+	bool write(std::string_view data);
+
+	/** Send @a data, completes with its size once the transfer ended.
+	 *
+	 * Waits for a transfer already in flight instead of dropping @a data,
+	 * which must stay valid until completion. Writes still queued are sent
+	 * first, so the output keeps its order. Only one async_write() may be
+	 * outstanding at a time. When stopped while the transfer is in flight,
+	 * done is only sent once the hardware released the buffer.
+	 *
+	 * Started from the main loop. Like write(), @a data goes to the history
+	 * while no host has the port open, and completes right away.
+	 */
+	auto async_write(std::string_view data, io_deadline deadline = {}) {
+		return write_sender{*this, data, deadline};
+	}
+
+	/** Format @a args into the transmit buffer, e.g. print<"t={} v={:x}\r\n">(t, v).
+	 *
+	 * The format is parsed at compile time (see static_format) and the output
+	 * written in place in the filling half, no allocation nor copy. Behaves
+	 * like write() otherwise; the output is dropped when its upper bound does
+	 * not fit in the half.
+	 *
+	 * While no host has the port open, the output is formatted in a scratch
+	 * the size of a half before going to the history: the same outputs fit.
+	 *
+	 * @return false when dropped
+	 */
+	template <ctll::fixed_string Format, typename...Args>
+	bool print(Args const &...args) noexcept {
+		using format = static_format<Format>;
+		if (!host_connected()) {
+			if (format::max_size(args...) > print_scratch_.size()) {
+				return false;
+			}
+			history_.push({print_scratch_.data(), format::format_to(print_scratch_.data(), args...)});
+			return true;
+		}
+		replay();
+		bool const queued = tx_buffer_.emplace(format::max_size(args...), [&args...](char *out) noexcept {
+			return out + format::format_to(out, args...);
+		});
+		if (queued && tx_buffer_.pending() >= max_packet_size) {
+			flush();
+		}
+		return queued;
+	}
+
+	/** Queue @a fragments back to back as one write, without concatenating them first.
+	 *
+	 * Completes with the number of bytes queued once they have been copied
+	 * into the transmit buffer, waiting for a transfer to complete when the
+	 * filling half is full. The fragments must stay valid until completion.
+	 * Shares its completion event with async_write(), only one of them may be
+	 * outstanding at a time. A transfer completion only flushes, the staging
+	 * is retried from the main loop through io_completions.
+	 *
+	 * Started from the main loop. Like write(), the fragments go to the
+	 * history while no host has the port open, and it completes right away.
+	 */
+	auto writev(std::span<const std::string_view> fragments, io_deadline deadline = {}) {
+		return writev_sender{*this, fragments, deadline};
+	}
+
+	/** Stream @a size bytes produced by @a fill at bus rate.
+	 *
+	 * @a buffer is split in two halves (rounded down to whole packets): one
+	 * is on the wire as a single multi-packet transfer while @a fill writes
+	 * the next one. Transfers of a stream are not terminated by ZLPs, only
+	 * the last one is when it ends on a packet boundary.
+	 *
+	 * @a fill is called as size_t(std::span<std::byte>) from the USB
+	 * interrupt, returns how many bytes it wrote, 0 when it has nothing yet
+	 * (it is then polled again on every frame and a stall is counted). The
+	 * endpoint is held for the whole stream, write() output is queued until
+	 * the end. Completes with the stream_stats.
+	 */
+	template <typename Fill>
+	auto stream(std::span<std::byte> buffer, size_t size, Fill fill, io_deadline deadline = {}) {
+		return stream_sender<Fill>{*this, buffer, size, std::move(fill), deadline};
+	}
+
+	/** True while the host has the port open (DTR set).
+	 *
+	 * Producers of periodic output can skip or downsample while it is false,
+	 * what they still write() is kept in a bounded history instead of being
+	 * queued for a host that is not there. Always true for channels without
+	 * line state.
+	 */
+	static bool host_connected() noexcept {
+		return host_connected_.load(std::memory_order_acquire);
+	}
+
+	/** Complete once host_connected() equals @a connected, right away if it already does.
+	 *
+	 * Only one wait_host() may be outstanding at a time.
+	 */
+	auto wait_host(bool connected = true, io_deadline deadline = {}) {
+		return host_sender{*this, connected, deadline};
+	}
+
+	/** Queue the history recorded while disconnected, once per connection.
+	 *
+	 * Main loop only. write() and print() call it before their own output,
+	 * call it after wait_host() to replay without waiting for new output.
+	 */
+	static void replay() noexcept {
+		if (!replay_pending_.exchange(false, std::memory_order_acq_rel)) {
+			return;
+		}
+		history_.drain([](std::string_view part) noexcept {
+			tx_buffer_.push(part);
+		});
+		flush();
+	}
+
+	/** Bytes of history lost while disconnected because newer output took their place. */
+	static size_t history_overwritten() noexcept {
+		return history_.overwritten();
+	}
+
+	/** Start a transfer of @a data on the IN endpoint. */
+	static tx_status transmit(std::string_view data) noexcept {
+		if (tx_busy_.exchange(true, std::memory_order_acq_rel)) {
+			return tx_status::busy;
+		}
+		auto const status = tx_start(data);
+		if (status == tx_status::fail) {
+			tx_busy_.store(false, std::memory_order_release);
+		}
+		return status;
+	}
+
+	/** Send the queued writes as one transfer if the endpoint is idle.
+	 *
+	 * The halves of tx_buffer_ only swap here, with the endpoint held and idle.
+	 *
+	 * A batch that is a multiple of max_packet_size is terminated by the ZLP
+	 * the CDC class appends, its completion is only reported after that ZLP.
+	 * Nothing is sent when the queue is empty: a zero length transfer would
+	 * be seen by the host as an (empty) end of transfer.
+	 *
+	 * A batch the endpoint refused is kept and sent first by the next flush,
+	 * on start of frame or transfer completion: only writes that did not fit
+	 * are dropped.
+	 */
+	static void flush() noexcept {
+		if (tx_buffer_.pending() == 0 || tx_busy_.exchange(true, std::memory_order_acq_rel)) {
+			return;
+		}
+		auto const batch = tx_buffer_.swap();
+		if (batch.data.empty()) {
+			tx_busy_.store(false, std::memory_order_release);
+			return;
+		}
+		if (tx_start(batch.data) != tx_status::ok) {
+			// given back before the endpoint is, whoever takes it next sends it first
+			tx_buffer_.retry(batch);
+			tx_busy_.store(false, std::memory_order_release);
+			return;
+		}
+		if (dispatch_queued_.exchange(false, std::memory_order_acq_rel)) {
+			auto const elapsed = cycle_counter::elapsed(dispatched_at_, cycle_counter::now());
+			latency_.last_dispatch_to_tx = elapsed;
+			if (elapsed > latency_.max_dispatch_to_tx) {
+				latency_.max_dispatch_to_tx = elapsed;
+			}
+		}
+		tx_stats_.flushes += 1;
+		tx_stats_.writes += batch.writes;
+		tx_stats_.last_coalesced = batch.writes;
+		tx_stats_.max_coalesced = std::max(tx_stats_.max_coalesced, batch.writes);
+	}
+
+	static tx_flush_stats const &tx_stats() noexcept {
+		return tx_stats_;
+	}
+
+	/** Number of write() calls dropped because their half was full. */
+	static size_t tx_dropped() noexcept {
+		return tx_buffer_.dropped();
+	}
+
+	/** ISR-to-dispatch and dispatch-to-TX latencies of the receive/write paths.
+	 *
+	 * Dispatch is the last dispatched() call, TX the moment the flush
+	 * carrying the first write() queued after it starts the transfer. Writes
+	 * that went to the history or were dropped are not measured.
+	 */
+	static latency_stats const &latency() noexcept {
+		return latency_;
+	}
+
+	/** Number of times the host was NAKed because every receive buffer was leased. */
+	static size_t rx_naks() noexcept {
+		return rx_pool_.parks();
+	}
+
+	/** Number of packets dropped because no receive buffer was armed. */
+	static size_t rx_overflows() noexcept {
+		return rx_pool_.dropped();
+	}
+
+	/** Buffer the OUT endpoint is armed with at class init, may be nullptr. */
+	static uint8_t *arm() noexcept {
+		return rx_pool_.arm();
+	}
+
+	/** Called from CDC_Receive_FS (USB interrupt).
+	 *
+	 * @return the buffer to re-arm the OUT endpoint with, nullptr to NAK the host.
+	 */
+	static uint8_t *notify(size_t size, cycle_counter::stamp stamp) {
+		auto *next = rx_pool_.commit(size, stamp);
+		if (rx_pool_.has_ready()) {
+			rx_binding::fire();
+		}
+		return next;
+	}
+
+	/** Called from the start-of-frame callback (USB interrupt). */
+	static void frame() noexcept {
+		frames_.fetch_add(1, std::memory_order_relaxed);
+		sof_binding::fire();
+		stream_sof_binding::fire();
+		flush();
+	}
+
+	/** Called on SET_CONTROL_LINE_STATE and class de-init (USB interrupt). */
+	static void line_state(bool dtr) noexcept {
+		if constexpr (Channel::has_line_state) {
+			auto const was = host_connected_.exchange(dtr, std::memory_order_acq_rel);
+			if (dtr == was) {
+				return;
+			}
+			if (dtr) {
+				replay_pending_.store(true, std::memory_order_release);
+			}
+			host_binding::fire();
+		}
+	}
+
+	/** Called once a transfer ended, ZLP included (USB interrupt). */
+	static void tx_complete() noexcept {
+		tx_busy_.store(false, std::memory_order_release);
+		// a waiting stream() takes the endpoint first, a waiting async_write()
+		// only when nothing is queued (it flushes the queue otherwise)
+		tx_binding::fire();
+		flush();
+	}
+
+	/** Called on class de-init (USB interrupt).
+	 *
+	 * A transfer in flight never completes: the endpoint is released, queued
+	 * writes are dropped and waiting transmit operations fail with
+	 * std::errc::connection_reset.
+	 */
+	static void tx_reset() noexcept {
+		tx_buffer_.reset();
+		dispatch_queued_.store(false, std::memory_order_relaxed);
+		tx_busy_.store(false, std::memory_order_release);
+		tx_resets_.fetch_add(1, std::memory_order_acq_rel);
+		tx_binding::fire();
+	}
+
+	/** Give a leased buffer back, re-arming the endpoint if it was parked.
+	 *
+	 * Outside of interrupts OTG_FS is masked meanwhile, so releases never
+	 * overlap and the re-arm does not race the endpoint interrupt.
+	 */
+	static void release(uint8_t index) noexcept;
+
+private:
+
+	static bool tx_reset_since(uint32_t epoch) noexcept {
+		return tx_resets_.load(std::memory_order_acquire) != epoch;
+	}
+
+	/** Start a transfer, tx_busy_ must be held and is still held on return. */
+	static tx_status tx_start(std::string_view data) noexcept;
+
+	/** Start one transfer of a stream, ended by a ZLP only when @a last. */
+	static tx_status tx_start_stream(std::string_view data, bool last) noexcept;
+
+	line_buffer<max_line_length> lines_{};
+	rx_lease partial_{};
+	size_t partial_offset_ = 0;
+	cycle_counter::stamp partial_received_at_ = 0;
+
+	/** Unconsumed bytes of the oldest received packet, empty when none. */
+	std::string_view peek() noexcept {
+		while (!partial_ || partial_offset_ >= partial_.size()) {
+			// zero-length packets carry nothing for byte readers, give them back
+			partial_.reset();
+			partial_ = rx_lease{rx_pool_.acquire()};
+			partial_offset_ = 0;
+			if (!partial_) {
+				return {};
+			}
+			partial_received_at_ = partial_.received_at();
+		}
+		return partial_.view().substr(partial_offset_);
+	}
+
+	/** Mark @a count bytes returned by peek() as consumed. */
+	void consume(size_t count) noexcept {
+		partial_offset_ += count;
+		if (partial_offset_ >= partial_.size()) {
+			partial_.reset();
 		}
 	}
 };
+
+/** The router command channel. */
+using usb = basic_usb<usb_command_channel>;
+
+/** The bulk data channel. */
+using usb_data = basic_usb<usb_data_channel>;
+
+extern template class basic_usb<usb_command_channel>;
+extern template class basic_usb<usb_data_channel>;
 }
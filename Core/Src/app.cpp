@@ -8,23 +8,25 @@
 #include <unifex/task.hpp>
 #include <unifex/when_all.hpp>
 #include <unifex/sync_wait.hpp>
-#include <unifex/stop_when.hpp>
+#include <unifex/done_as_optional.hpp>
 #include <unifex/scheduler_concepts.hpp>
+#include <unifex/stream_concepts.hpp>
 
-#include <unifex/stm32/stm32_bare_context.hpp>
 
+#include <tickless_context.hpp>
+#include <tim2_timer.hpp>
 #include <usb.hpp>
 #include <gpio.hpp>
+#include <log_volume.hpp>
 
 #include <g6/router.hpp>
 
-#include <cstring>
-
-#include <memory_resource>
+#include <algorithm>
 
 
 extern "C" {
 #include <main.h>
+#include <usbd_conf.h>
 }
 
 using unifex::task;
@@ -39,17 +41,23 @@ using namespace std::literals::chrono_literals;
 
 extern "C" int application(void) {
 
-	unifex::stm32_bare_context ctx{};
-    auto scheduler = ctx.get_scheduler();
+	stm32::tickless_context<stm32::tim2_timer> ctx{};
+    auto scheduler = ctx.get_scheduler(stm32::priority::low); // housekeeping
+    auto command_scheduler = ctx.get_scheduler(stm32::priority::high);
 
     auto led_toggler = [&scheduler](stm32::gpio const&gpio, auto const &delay) -> task<void> {
+    	auto ticks = stm32::schedule_every(scheduler, delay);
 		while (true) {
-			co_await schedule_at(scheduler, now(scheduler) + delay);
+			co_await unifex::next(ticks);
 			gpio.toogle();
+			if (ticks.period() != delay) {
+				ticks.period(delay); // changed by red-delay
+			}
 		}
     };
 
     auto usb = stm32::usb{};
+    auto usb_data = stm32::usb_data{};
 
     auto green_led = stm32::gpio{LD1_GPIO_Port, LD1_Pin};
     auto blue_led = stm32::gpio{LD2_GPIO_Port, LD2_Pin};
@@ -57,6 +65,8 @@ extern "C" int application(void) {
 	auto user_btn = stm32::gpio{USER_Btn_GPIO_Port, USER_Btn_Pin};
 
 	std::chrono::milliseconds red_delay = 500ms;
+	size_t bench_size = 0;
+	static std::array<std::byte, 4096> bench_buffer;
 
 	g6::router::router commands_router{
 	    g6::router::on<R"(echo (\w+)\r\n)">([](const std::string &value) -> std::string {
@@ -67,44 +77,89 @@ extern "C" int application(void) {
 			return "ok\r\n";
 		}),
 		g6::router::on<R"(red-delay (\d+)\r\n)">([&red_delay](int value) -> std::string {
-	    	red_delay = std::chrono::milliseconds{value};
+	    	// a zero period would divide by zero in the stream
+	    	red_delay = std::chrono::milliseconds{std::max(value, 1)};
+			return "ok\r\n";
+		}),
+		g6::router::on<R"(stream-bench (\d+)\r\n)">([&bench_size](int value) -> std::string {
+	    	bench_size = value;
 			return "ok\r\n";
 		}),
+		g6::router::on<R"(run-queues\r\n)">([&ctx]() -> std::string {
+			std::string res = "queues";
+			for (auto level : {stm32::priority::high, stm32::priority::normal, stm32::priority::low}) {
+				auto stats = ctx.stats(level);
+				res += " " + std::to_string(stats.depth) + " " + std::to_string(stats.high_water);
+			}
+			return res + " batch " + std::to_string(ctx.batch_high_water()) + "\r\n";
+		}),
+		g6::router::on<R"(usb-arena\r\n)">([]() -> std::string {
+			USBD_ArenaStatsTypeDef stats;
+			USBD_static_stats(&stats);
+			return "arena " + std::to_string(stats.used) + " " + std::to_string(stats.high_water) + " "
+				+ std::to_string(stats.size) + " " + std::to_string(stats.failed) + "\r\n";
+		}),
 	    g6::router::on<R"(.*)">([]() -> std::string {
 	        return "no such command\r\n";
 	    })};
 
     sync_wait(when_all(
     	[&]() -> task<void> {
-
-			std::array<std::byte, 1024u> cmd_data;
-			std::pmr::monotonic_buffer_resource pool{ cmd_data.data(), cmd_data.size() };
-			std::pmr::string str{&pool};
-
     		while(true) {
 
-    			auto data = co_await (usb.receive() | unifex::stop_when(schedule_after(scheduler, 1s)));
-
-				// Within IRQ
-
-				if (data.size()) {
-					str = data; // copy to local stack
-					co_await schedule(scheduler); // schedule for main-loop processing
-
-					// Within main loop
-
-					auto res = commands_router(str);
-					usb.write(res);
+    			auto line = co_await unifex::done_as_optional(usb.read_line(1s));
+
+				// Within main loop: the read registers a stop callback, so its
+				// completion is deferred to io_completions and resumes us from
+				// ctx.run(), ahead of every ready queue
+
+				if (line) {
+					// queue the command as high priority work instead, other
+					// deferred completions and due timers go first, housekeeping after
+					co_await schedule(command_scheduler);
+					usb.dispatched(line->received_at);
+
+					// Within main loop, line stays valid until the next read_line()
+
+					auto res = commands_router(line->text);
+#if (USBD_ENABLE_MSC == 1U)
+					// timestamped transcript, LOG.TXT on the mass storage interface
+					stm32::logs().print<"{} {}">(std::chrono::duration_cast<std::chrono::milliseconds>(stm32::io_clock::now().time_since_epoch()).count(), line->text);
+#endif
+					usb.write(res); // coalesced with other replies until the next frame
+
+					if (bench_size) {
+						// counter pattern on the bulk interface, checked by cli.py stream-bench
+						uint8_t next = 0;
+						auto stats = co_await usb_data.stream(bench_buffer, std::exchange(bench_size, 0),
+							[&next](std::span<std::byte> buffer) noexcept {
+								for (auto &byte : buffer) {
+									byte = std::byte{next++};
+								}
+								return buffer.size();
+							});
+						usb.print<"stream {} {} {}\r\n">(stats.bytes, stats.transfers, stats.stalls);
+					}
 				}
     		}
     	}(),
 		[&]() -> task<void> {
+			auto polls = stm32::schedule_every(scheduler, 250ms);
     		while (true) {
     			green_led = bool(user_btn);
-    			co_await schedule_at(scheduler, now(scheduler) + 250ms);
+    			co_await unifex::next(polls);
     		}
     	}(),
 		led_toggler(red_led, red_delay),
+		[&]() -> task<void> {
+			while (true) {
+				// replay what was written while the port was closed as soon as it opens
+				co_await usb.wait_host(true);
+				co_await schedule(command_scheduler); // same as a command, see above
+				usb.replay();
+				co_await usb.wait_host(false);
+			}
+		}(),
 		[&]() -> task<void> {
 
 			ctx.run();
@@ -0,0 +1,35 @@
+/*
+ * log_volume.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Sylvain Garcia
+ */
+
+#include <log_volume.hpp>
+
+extern "C" {
+#include <usbd_conf.h>
+}
+
+// the 16 KiB store only exists for the mass storage view
+#if (USBD_ENABLE_MSC == 1U)
+
+namespace stm32 {
+
+static app_log log_{};
+static log_volume const volume_{log_};
+
+app_log &logs() noexcept {
+	return log_;
+}
+}
+
+extern "C" uint32_t USB_Msc_BlockCount(void) {
+	return stm32::log_volume::block_count;
+}
+
+extern "C" void USB_Msc_ReadBlock(uint32_t block, uint8_t *buffer) {
+	stm32::volume_.read(block, std::span<uint8_t, stm32::log_volume::block_size>{buffer, stm32::log_volume::block_size});
+}
+
+#endif /* USBD_ENABLE_MSC */
@@ -46,6 +46,7 @@
 
 /* Private function prototypes -----------------------------------------------*/
 /* USER CODE BEGIN PFP */
+extern void TIM2_Event(void);
 
 /* USER CODE END PFP */
 
@@ -183,7 +184,8 @@ void PendSV_Handler(void)
 void SysTick_Handler(void)
 {
   /* USER CODE BEGIN SysTick_IRQn 0 */
-
+  /* Never taken: SysTick is not started, HAL_InitTick() and HAL_GetTick()
+   * run the HAL time base on TIM2 (tim2_timer.cpp). */
   /* USER CODE END SysTick_IRQn 0 */
   HAL_IncTick();
   /* USER CODE BEGIN SysTick_IRQn 1 */
@@ -214,4 +216,12 @@ void OTG_FS_IRQHandler(void)
 
 /* USER CODE BEGIN 1 */
 
+/**
+  * @brief This function handles TIM2 global interrupt (scheduler clock and wake-up).
+  */
+void TIM2_IRQHandler(void)
+{
+  TIM2_Event();
+}
+
 /* USER CODE END 1 */
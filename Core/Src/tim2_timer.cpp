@@ -0,0 +1,138 @@
+/*
+ * tim2_timer.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Sylvain Garcia
+ */
+
+#include <tim2_timer.hpp>
+
+#include <io_deadline.hpp>
+
+namespace stm32 {
+
+tim2_clock::time_point tim2_clock::now() noexcept {
+	uint32_t epochs;
+	uint32_t low;
+	bool wrapped;
+	do {
+		epochs = epochs_;
+		low = TIM2->CNT;
+		// overflow not yet accounted for by the update interrupt (masked or pending)
+		wrapped = (TIM2->SR & TIM_SR_UIF) != 0 && low < 0x80000000U;
+	} while (epochs != epochs_);
+	if (wrapped) {
+		epochs += 1;
+	}
+	return time_point{duration{(int64_t(epochs) << 32) | low}};
+}
+
+void tim2_timer::start() noexcept {
+	__HAL_RCC_TIM2_CLK_ENABLE();
+
+	// APB1 timers run at twice PCLK1 unless APB1 is undivided
+	uint32_t timer_clock = HAL_RCC_GetPCLK1Freq();
+	if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_CFGR_PPRE1_DIV1) {
+		timer_clock *= 2;
+	}
+
+	// started again after every clock change, see HAL_InitTick(): keep the time
+	auto const count = TIM2->CNT;
+	TIM2->CR1 = 0;
+	TIM2->PSC = timer_clock / 1000000U - 1;
+	TIM2->ARR = 0xFFFFFFFFU;
+	TIM2->EGR = TIM_EGR_UG; // load the prescaler
+	TIM2->CNT = count;
+	TIM2->SR = 0;
+	TIM2->DIER = TIM_DIER_UIE;
+
+	HAL_NVIC_SetPriority(TIM2_IRQn, 0, 0);
+	HAL_NVIC_EnableIRQ(TIM2_IRQn);
+
+	TIM2->CR1 = TIM_CR1_CEN;
+}
+
+bool tim2_timer::arm(clock::time_point due) noexcept {
+	auto const ticks = due.time_since_epoch().count();
+	auto const now = clock::now();
+	if (!(now < due)) {
+		return false;
+	}
+	if ((ticks >> 32) != (now.time_since_epoch().count() >> 32)) {
+		// not in this epoch: the update interrupt wakes the loop, which arms again
+		disarm();
+		return true;
+	}
+	TIM2->CCR1 = uint32_t(ticks);
+	TIM2->SR = ~TIM_SR_CC1IF;
+	TIM2->DIER = TIM2->DIER | TIM_DIER_CC1IE;
+	// the counter may have passed CCR1 while programming it
+	return clock::now() < due;
+}
+
+void tim2_timer::alarm(clock::time_point due) noexcept {
+	auto const ticks = due.time_since_epoch().count();
+	if ((ticks >> 32) > (clock::now().time_since_epoch().count() >> 32)) {
+		// not in this epoch: the update interrupt expires deadlines, which programs it again
+		cancel_alarm();
+		return;
+	}
+	TIM2->CCR2 = uint32_t(ticks);
+	TIM2->SR = ~TIM_SR_CC2IF;
+	TIM2->DIER = TIM2->DIER | TIM_DIER_CC2IE;
+	if (!(clock::now() < due)) {
+		// already due, or passed while programming it
+		TIM2->EGR = TIM_EGR_CC2G;
+	}
+}
+
+void tim2_timer::on_interrupt() noexcept {
+	auto const sr = TIM2->SR;
+	auto const dier = TIM2->DIER;
+	bool expire = false;
+	if (sr & TIM_SR_UIF) {
+		tim2_clock::epochs_ = tim2_clock::epochs_ + 1;
+		TIM2->SR = ~TIM_SR_UIF;
+		expire = true;
+	}
+	if ((sr & TIM_SR_CC1IF) && (dier & TIM_DIER_CC1IE)) {
+		// one-shot: run() arms the next deadline
+		TIM2->SR = ~TIM_SR_CC1IF;
+		TIM2->DIER = TIM2->DIER & ~TIM_DIER_CC1IE;
+	}
+	if ((sr & TIM_SR_CC2IF) && (dier & TIM_DIER_CC2IE)) {
+		// one-shot as well, io_deadlines::expire() programs the next one
+		TIM2->SR = ~TIM_SR_CC2IF;
+		TIM2->DIER = TIM2->DIER & ~TIM_DIER_CC2IE;
+		expire = true;
+	}
+	if (expire) {
+		io_deadlines::expire();
+	}
+}
+}
+
+extern "C" void TIM2_Event(void) {
+	stm32::tim2_timer::on_interrupt();
+}
+
+// The HAL time base reads tim2_clock and SysTick is never started, an idle
+// core only wakes up for TIM2 compares and overflows.
+
+extern "C" HAL_StatusTypeDef HAL_InitTick(uint32_t TickPriority) {
+	// TIM2 stays at the priority of OTG_FS whatever the HAL asks for
+	(void)TickPriority;
+	stm32::tim2_timer::start();
+	return HAL_OK;
+}
+
+extern "C" uint32_t HAL_GetTick(void) {
+	return uint32_t(std::chrono::duration_cast<std::chrono::milliseconds>(stm32::tim2_clock::now().time_since_epoch()).count());
+}
+
+extern "C" void HAL_SuspendTick(void) {
+	// nothing periodic to suspend
+}
+
+extern "C" void HAL_ResumeTick(void) {
+}
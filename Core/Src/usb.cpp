@@ -9,13 +9,143 @@
 #include <usb.hpp>
 
 #include <usbd_cdc_if.h>
+#include <usbd_composite.h>
+
+#include <type_traits>
+#include <utility>
 
 namespace stm32 {
-void usb::write(std::string_view data) {
-	CDC_Transmit_FS(reinterpret_cast<uint8_t*>(const_cast<char*>(data.data())), data.size());
+
+static_assert(usb::tx_buffer_size == APP_TX_DATA_SIZE);
+static_assert(usb_data::tx_buffer_size == APP_TX_DATA_SIZE);
+
+template <typename Channel>
+static constexpr bool is_command = std::is_same_v<Channel, usb_command_channel>;
+
+template <typename Channel>
+bool basic_usb<Channel>::write(std::string_view data) {
+	if (!host_connected()) {
+		history_.push(data);
+		return true;
+	}
+	replay();
+	if (!tx_buffer_.push(data)) {
+		return false;
+	}
+	if (std::exchange(dispatch_pending_, false)) {
+		// dispatch-to-TX is measured by the flush sending this write
+		dispatch_queued_.store(true, std::memory_order_release);
+	}
+	if (tx_buffer_.pending() >= max_packet_size) {
+		flush();
+	}
+	return true;
+}
+
+template <typename Channel>
+typename basic_usb<Channel>::tx_status basic_usb<Channel>::tx_start(std::string_view data) noexcept {
+	auto *buffer = reinterpret_cast<uint8_t*>(const_cast<char*>(data.data()));
+	uint8_t result;
+	if constexpr (is_command<Channel>) {
+		result = CDC_Transmit_FS(buffer, data.size());
+	} else {
+		result = CDC_Data_Transmit_FS(buffer, data.size(), 1);
+	}
+	switch (result) {
+	case USBD_OK:
+		return tx_status::ok;
+	case USBD_BUSY:
+		// not started by us, its completion clears tx_busy_ all the same
+		return tx_status::busy;
+	default:
+		return tx_status::fail;
+	}
+}
+
+template <typename Channel>
+typename basic_usb<Channel>::tx_status basic_usb<Channel>::tx_start_stream(std::string_view data, bool last) noexcept {
+	auto *buffer = reinterpret_cast<uint8_t*>(const_cast<char*>(data.data()));
+	uint8_t result;
+	if constexpr (is_command<Channel>) {
+		result = CDC_TransmitStream_FS(buffer, data.size(), last);
+	} else {
+		result = CDC_Data_Transmit_FS(buffer, data.size(), last);
+	}
+	switch (result) {
+	case USBD_OK:
+		return tx_status::ok;
+	case USBD_BUSY:
+		return tx_status::busy;
+	default:
+		return tx_status::fail;
+	}
 }
+
+template <typename Channel>
+void basic_usb<Channel>::release(uint8_t index) noexcept {
+	// readers completing in the OTG_FS interrupt release too: keep it out so
+	// the free ring has one producer at a time and the re-arm is not preempted
+	bool const masked = !in_isr() && NVIC_GetEnableIRQ(OTG_FS_IRQn);
+	if (masked) {
+		HAL_NVIC_DisableIRQ(OTG_FS_IRQn);
+	}
+	if (auto *buffer = rx_pool_.release(index)) {
+		if constexpr (is_command<Channel>) {
+			CDC_Rearm_FS(buffer);
+		} else {
+			CDC_Data_Rearm_FS(buffer);
+		}
+	}
+	if (masked) {
+		HAL_NVIC_EnableIRQ(OTG_FS_IRQn);
+	}
+}
+
+template class basic_usb<usb_command_channel>;
+template class basic_usb<usb_data_channel>;
+}
+
+extern "C" uint8_t *USB_RxBuffer(void) {
+	return stm32::usb::arm();
+}
+
+extern "C" uint8_t *USB_Notify(uint8_t *data, size_t size) {
+	auto const stamp = stm32::cycle_counter::now();
+	(void)data;
+	return stm32::usb::notify(size, stamp);
+}
+
+extern "C" void USB_TxComplete(void) {
+	stm32::usb::tx_complete();
+}
+
+extern "C" void USB_TxReset(void) {
+	stm32::usb::tx_reset();
+}
+
+extern "C" void USB_LineState(uint8_t dtr) {
+	stm32::usb::line_state(dtr != 0);
+}
+
+extern "C" uint8_t *USB_Data_RxBuffer(void) {
+	return stm32::usb_data::arm();
+}
+
+extern "C" uint8_t *USB_Data_Notify(uint8_t *data, size_t size) {
+	auto const stamp = stm32::cycle_counter::now();
+	(void)data;
+	return stm32::usb_data::notify(size, stamp);
+}
+
+extern "C" void USB_Data_TxComplete(void) {
+	stm32::usb_data::tx_complete();
+}
+
+extern "C" void USB_Data_TxReset(void) {
+	stm32::usb_data::tx_reset();
 }
 
-extern "C" void USB_Notify(uint8_t *data, size_t size) {
-	stm32::usb::notify(data, size);
+extern "C" void USB_SOF(void) {
+	stm32::usb::frame();
+	stm32::usb_data::frame();
 }
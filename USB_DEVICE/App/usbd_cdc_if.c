@@ -30,7 +30,11 @@
 
 /* USER CODE BEGIN PV */
 /* Private variables ---------------------------------------------------------*/
-extern void USB_Nofity(uint8_t *data, size_t size);
+extern uint8_t *USB_RxBuffer(void);
+extern uint8_t *USB_Notify(uint8_t *data, size_t size);
+extern void USB_TxComplete(void);
+extern void USB_TxReset(void);
+extern void USB_LineState(uint8_t dtr);
 /* USER CODE END PV */
 
 /** @addtogroup STM32_USB_OTG_DEVICE_LIBRARY
@@ -87,9 +91,11 @@ extern void USB_Nofity(uint8_t *data, size_t size);
 /* Create buffer for reception and transmission           */
 /* It's up to user to redefine and/or remove those define */
 /** Received data over USB are stored in this buffer      */
+/* (only used as a fallback when every pool buffer is leased at init) */
 uint8_t UserRxBufferFS[APP_RX_DATA_SIZE];
 
 /** Data to send over USB CDC are stored in this buffer   */
+/* (both halves of the stm32::usb ping-pong transmit buffer) */
 uint8_t UserTxBufferFS[APP_TX_DATA_SIZE];
 
 /* USER CODE BEGIN PRIVATE_VARIABLES */
@@ -151,8 +157,9 @@ static int8_t CDC_Init_FS(void)
 {
   /* USER CODE BEGIN 3 */
   /* Set Application Buffers */
+  uint8_t *rx_buffer = USB_RxBuffer();
   USBD_CDC_SetTxBuffer(&hUsbDeviceFS, UserTxBufferFS, 0);
-  USBD_CDC_SetRxBuffer(&hUsbDeviceFS, UserRxBufferFS);
+  USBD_CDC_SetRxBuffer(&hUsbDeviceFS, rx_buffer != NULL ? rx_buffer : UserRxBufferFS);
   return (USBD_OK);
   /* USER CODE END 3 */
 }
@@ -164,6 +171,9 @@ static int8_t CDC_Init_FS(void)
 static int8_t CDC_DeInit_FS(void)
 {
   /* USER CODE BEGIN 4 */
+  /* reset or unplug: nobody listens anymore, nor acknowledges what was sent */
+  USB_LineState(0U);
+  USB_TxReset();
   return (USBD_OK);
   /* USER CODE END 4 */
 }
@@ -226,7 +236,8 @@ static int8_t CDC_Control_FS(uint8_t cmd, uint8_t* pbuf, uint16_t length)
     break;
 
     case CDC_SET_CONTROL_LINE_STATE:
-
+      /* no data stage, pbuf is the setup request itself; wValue bit 0 is DTR */
+      USB_LineState((uint8_t)(((USBD_SetupReqTypedef *)pbuf)->wValue & 0x01U));
     break;
 
     case CDC_SEND_BREAK:
@@ -259,9 +270,12 @@ static int8_t CDC_Control_FS(uint8_t cmd, uint8_t* pbuf, uint16_t length)
 static int8_t CDC_Receive_FS(uint8_t* Buf, uint32_t *Len)
 {
   /* USER CODE BEGIN 6 */
-  USBD_CDC_SetRxBuffer(&hUsbDeviceFS, &Buf[0]);
-  USBD_CDC_ReceivePacket(&hUsbDeviceFS);
-  USB_Notify(Buf, *Len);
+  uint8_t *next = USB_Notify(Buf, *Len);
+  if (next != NULL) {
+    USBD_CDC_SetRxBuffer(&hUsbDeviceFS, next);
+    USBD_CDC_ReceivePacket(&hUsbDeviceFS);
+  }
+  /* else every buffer is leased: the endpoint is left NAKing until CDC_Rearm_FS */
   return (USBD_OK);
   /* USER CODE END 6 */
 }
@@ -292,6 +306,64 @@ uint8_t CDC_Transmit_FS(uint8_t* Buf, uint16_t Len)
 }
 
 /* USER CODE BEGIN PRIVATE_FUNCTIONS_IMPLEMENTATION */
+/**
+  * @brief  CDC_Rearm_FS
+  *         Arm the OUT endpoint on a new receive buffer after it has been
+  *         left NAKing by CDC_Receive_FS.
+  *
+  * @param  Buf: Buffer the next packet will be received in
+  * @retval USBD_OK if all operations are OK else USBD_FAIL
+  */
+uint8_t CDC_Rearm_FS(uint8_t* Buf)
+{
+  USBD_CDC_SetRxBuffer(&hUsbDeviceFS, Buf);
+  return USBD_CDC_ReceivePacket(&hUsbDeviceFS);
+}
+
+/**
+  * @brief  CDC_TransmitStream_FS
+  *         Like CDC_Transmit_FS for one transfer of a longer stream: a transfer
+  *         followed by more data is not terminated by a ZLP, even when it ends
+  *         with a full packet. Only the Last one is.
+  *
+  * @param  Buf: Buffer of data to be sent
+  * @param  Len: Number of data to be sent (in bytes)
+  * @param  Last: Non zero for the last transfer of the stream
+  * @retval USBD_OK if all operations are OK else USBD_FAIL or USBD_BUSY
+  */
+uint8_t CDC_TransmitStream_FS(uint8_t* Buf, uint16_t Len, uint8_t Last)
+{
+  USBD_CDC_HandleTypeDef *hcdc = (USBD_CDC_HandleTypeDef*)hUsbDeviceFS.pClassData;
+  if (hcdc == NULL) {
+    return USBD_FAIL;
+  }
+  if (hcdc->TxState != 0) {
+    return USBD_BUSY;
+  }
+  /* USBD_CDC_TransmitPacket, with the ZLP decision made by total_length */
+  hcdc->TxState = 1;
+  hcdc->TxBuffer = Buf;
+  hcdc->TxLength = Len;
+  hUsbDeviceFS.ep_in[CDC_IN_EP & 0xFU].total_length = Last ? Len : 0U;
+  return USBD_LL_Transmit(&hUsbDeviceFS, CDC_IN_EP, Buf, Len);
+}
+
+/**
+  * @brief  CDC_TransmitCplt_FS
+  *         Called after the IN stage of endpoint epnum completed, notifies
+  *         the end of a CDC_Transmit_FS transfer once its ZLP (if any) is out.
+  *
+  * @param  epnum: Endpoint number
+  * @retval None
+  */
+void CDC_TransmitCplt_FS(uint8_t epnum)
+{
+  USBD_CDC_HandleTypeDef *hcdc = (USBD_CDC_HandleTypeDef*)hUsbDeviceFS.pClassData;
+  if (hcdc == NULL || (epnum | 0x80U) != CDC_IN_EP || hcdc->TxState != 0) {
+    return;
+  }
+  USB_TxComplete();
+}
 
 /* USER CODE END PRIVATE_FUNCTIONS_IMPLEMENTATION */
 
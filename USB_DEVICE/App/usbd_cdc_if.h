@@ -108,6 +108,9 @@ extern USBD_CDC_ItfTypeDef USBD_Interface_fops_FS;
 uint8_t CDC_Transmit_FS(uint8_t* Buf, uint16_t Len);
 
 /* USER CODE BEGIN EXPORTED_FUNCTIONS */
+uint8_t CDC_Rearm_FS(uint8_t* Buf);
+uint8_t CDC_TransmitStream_FS(uint8_t* Buf, uint16_t Len, uint8_t Last);
+void CDC_TransmitCplt_FS(uint8_t epnum);
 
 /* USER CODE END EXPORTED_FUNCTIONS */
 
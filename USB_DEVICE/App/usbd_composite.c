@@ -0,0 +1,424 @@
+/**
+  ******************************************************************************
+  * @file           : usbd_composite.c
+  * @brief          : CDC ACM command channel plus a bulk CDC data interface.
+  ******************************************************************************
+  * The CDC ACM function is handled by USBD_CDC unchanged (its handle stays in
+  * pClassData, which usbd_cdc_if.c relies on); this class only adds the
+  * interface association, the data interface and routes requests/endpoints.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_composite.h"
+#include "usbd_msc_ro.h"
+#include "usbd_ctlreq.h"
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  uint8_t *RxBuffer;
+  uint32_t TxState;
+  uint8_t AltSetting;
+} USBD_CDC_Data_HandleTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+extern USBD_HandleTypeDef hUsbDeviceFS;
+
+extern uint8_t *USB_Data_RxBuffer(void);
+extern uint8_t *USB_Data_Notify(uint8_t *data, size_t size);
+extern void USB_Data_TxComplete(void);
+extern void USB_Data_TxReset(void);
+
+uint8_t UserTxBufferDataFS[APP_TX_DATA_SIZE];
+
+static USBD_CDC_Data_HandleTypeDef hcdc_data;
+
+/* Private function prototypes -----------------------------------------------*/
+static uint8_t USBD_COMPOSITE_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx);
+static uint8_t USBD_COMPOSITE_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx);
+static uint8_t USBD_COMPOSITE_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req);
+static uint8_t USBD_COMPOSITE_EP0_RxReady(USBD_HandleTypeDef *pdev);
+static uint8_t USBD_COMPOSITE_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum);
+static uint8_t USBD_COMPOSITE_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum);
+static uint8_t *USBD_COMPOSITE_GetFSCfgDesc(uint16_t *length);
+static uint8_t *USBD_COMPOSITE_GetDeviceQualifierDescriptor(uint16_t *length);
+
+/* Private variables ---------------------------------------------------------*/
+USBD_ClassTypeDef USBD_COMPOSITE =
+{
+  .Init = USBD_COMPOSITE_Init,
+  .DeInit = USBD_COMPOSITE_DeInit,
+  .Setup = USBD_COMPOSITE_Setup,
+  .EP0_TxSent = NULL,
+  .EP0_RxReady = USBD_COMPOSITE_EP0_RxReady,
+  .DataIn = USBD_COMPOSITE_DataIn,
+  .DataOut = USBD_COMPOSITE_DataOut,
+  .SOF = NULL,
+  .IsoINIncomplete = NULL,
+  .IsoOUTIncomplete = NULL,
+  .GetHSConfigDescriptor = USBD_COMPOSITE_GetFSCfgDesc,
+  .GetFSConfigDescriptor = USBD_COMPOSITE_GetFSCfgDesc,
+  .GetOtherSpeedConfigDescriptor = USBD_COMPOSITE_GetFSCfgDesc,
+  .GetDeviceQualifierDescriptor = USBD_COMPOSITE_GetDeviceQualifierDescriptor,
+};
+
+/* USB composite device Configuration Descriptor */
+__ALIGN_BEGIN static uint8_t USBD_COMPOSITE_CfgFSDesc[USB_COMPOSITE_CONFIG_DESC_SIZ] __ALIGN_END =
+{
+  /* Configuration Descriptor */
+  0x09,                                       /* bLength: Configuration Descriptor size */
+  USB_DESC_TYPE_CONFIGURATION,                /* bDescriptorType: Configuration */
+  LOBYTE(USB_COMPOSITE_CONFIG_DESC_SIZ),      /* wTotalLength */
+  HIBYTE(USB_COMPOSITE_CONFIG_DESC_SIZ),
+  0x03,                                       /* bNumInterfaces: 3 interfaces */
+  0x01,                                       /* bConfigurationValue: Configuration value */
+  0x00,                                       /* iConfiguration: Index of string descriptor */
+  0xC0,                                       /* bmAttributes: self powered */
+  0x32,                                       /* MaxPower 100 mA */
+
+  /* Interface Association Descriptor: CDC ACM function */
+  0x08,                                       /* bLength */
+  0x0B,                                       /* bDescriptorType: IAD */
+  0x00,                                       /* bFirstInterface */
+  0x02,                                       /* bInterfaceCount */
+  0x02,                                       /* bFunctionClass: Communication Interface Class */
+  0x02,                                       /* bFunctionSubClass: Abstract Control Model */
+  0x01,                                       /* bFunctionProtocol: Common AT commands */
+  0x00,                                       /* iFunction */
+
+  /* Interface 0: CDC communication */
+  0x09,                                       /* bLength: Interface Descriptor size */
+  USB_DESC_TYPE_INTERFACE,                    /* bDescriptorType: Interface */
+  0x00,                                       /* bInterfaceNumber: Number of Interface */
+  0x00,                                       /* bAlternateSetting: Alternate setting */
+  0x01,                                       /* bNumEndpoints: One endpoint used */
+  0x02,                                       /* bInterfaceClass: Communication Interface Class */
+  0x02,                                       /* bInterfaceSubClass: Abstract Control Model */
+  0x01,                                       /* bInterfaceProtocol: Common AT commands */
+  0x00,                                       /* iInterface */
+
+  /* Header Functional Descriptor */
+  0x05,                                       /* bLength: Endpoint Descriptor size */
+  0x24,                                       /* bDescriptorType: CS_INTERFACE */
+  0x00,                                       /* bDescriptorSubtype: Header Func Desc */
+  0x10,                                       /* bcdCDC: spec release number */
+  0x01,
+
+  /* Call Management Functional Descriptor */
+  0x05,                                       /* bFunctionLength */
+  0x24,                                       /* bDescriptorType: CS_INTERFACE */
+  0x01,                                       /* bDescriptorSubtype: Call Management Func Desc */
+  0x00,                                       /* bmCapabilities: D0+D1 */
+  0x01,                                       /* bDataInterface */
+
+  /* ACM Functional Descriptor */
+  0x04,                                       /* bFunctionLength */
+  0x24,                                       /* bDescriptorType: CS_INTERFACE */
+  0x02,                                       /* bDescriptorSubtype: Abstract Control Management desc */
+  0x02,                                       /* bmCapabilities */
+
+  /* Union Functional Descriptor */
+  0x05,                                       /* bFunctionLength */
+  0x24,                                       /* bDescriptorType: CS_INTERFACE */
+  0x06,                                       /* bDescriptorSubtype: Union func desc */
+  0x00,                                       /* bMasterInterface: Communication class interface */
+  0x01,                                       /* bSlaveInterface0: Data Class Interface */
+
+  /* Endpoint 2 Descriptor: notifications */
+  0x07,                                       /* bLength: Endpoint Descriptor size */
+  USB_DESC_TYPE_ENDPOINT,                     /* bDescriptorType: Endpoint */
+  CDC_CMD_EP,                                 /* bEndpointAddress */
+  0x03,                                       /* bmAttributes: Interrupt */
+  LOBYTE(CDC_CMD_PACKET_SIZE),                /* wMaxPacketSize */
+  HIBYTE(CDC_CMD_PACKET_SIZE),
+  CDC_FS_BINTERVAL,                           /* bInterval */
+
+  /* Interface 1: CDC data, command channel */
+  0x09,                                       /* bLength: Endpoint Descriptor size */
+  USB_DESC_TYPE_INTERFACE,                    /* bDescriptorType */
+  0x01,                                       /* bInterfaceNumber: Number of Interface */
+  0x00,                                       /* bAlternateSetting: Alternate setting */
+  0x02,                                       /* bNumEndpoints: Two endpoints used */
+  0x0A,                                       /* bInterfaceClass: CDC */
+  0x00,                                       /* bInterfaceSubClass */
+  0x00,                                       /* bInterfaceProtocol */
+  0x00,                                       /* iInterface */
+
+  /* Endpoint OUT Descriptor */
+  0x07,                                       /* bLength: Endpoint Descriptor size */
+  USB_DESC_TYPE_ENDPOINT,                     /* bDescriptorType: Endpoint */
+  CDC_OUT_EP,                                 /* bEndpointAddress */
+  0x02,                                       /* bmAttributes: Bulk */
+  LOBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),        /* wMaxPacketSize */
+  HIBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),
+  0x00,                                       /* bInterval */
+
+  /* Endpoint IN Descriptor */
+  0x07,                                       /* bLength: Endpoint Descriptor size */
+  USB_DESC_TYPE_ENDPOINT,                     /* bDescriptorType: Endpoint */
+  CDC_IN_EP,                                  /* bEndpointAddress */
+  0x02,                                       /* bmAttributes: Bulk */
+  LOBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),        /* wMaxPacketSize */
+  HIBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),
+  0x00,                                       /* bInterval */
+
+  /* Interface 2: CDC data, bulk channel (or mass storage) */
+  0x09,                                       /* bLength: Endpoint Descriptor size */
+  USB_DESC_TYPE_INTERFACE,                    /* bDescriptorType */
+  CDC_DATA_IF,                                /* bInterfaceNumber: Number of Interface */
+  0x00,                                       /* bAlternateSetting: Alternate setting */
+  0x02,                                       /* bNumEndpoints: Two endpoints used */
+#if (USBD_ENABLE_MSC == 1U)
+  0x08,                                       /* bInterfaceClass: Mass Storage */
+  0x06,                                       /* bInterfaceSubClass: SCSI transparent */
+  0x50,                                       /* bInterfaceProtocol: Bulk-Only */
+#else
+  0x0A,                                       /* bInterfaceClass: CDC */
+  0x00,                                       /* bInterfaceSubClass */
+  0x00,                                       /* bInterfaceProtocol */
+#endif
+  0x00,                                       /* iInterface */
+
+  /* Endpoint OUT Descriptor */
+  0x07,                                       /* bLength: Endpoint Descriptor size */
+  USB_DESC_TYPE_ENDPOINT,                     /* bDescriptorType: Endpoint */
+  CDC_DATA_OUT_EP,                            /* bEndpointAddress */
+  0x02,                                       /* bmAttributes: Bulk */
+  LOBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),        /* wMaxPacketSize */
+  HIBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),
+  0x00,                                       /* bInterval */
+
+  /* Endpoint IN Descriptor */
+  0x07,                                       /* bLength: Endpoint Descriptor size */
+  USB_DESC_TYPE_ENDPOINT,                     /* bDescriptorType: Endpoint */
+  CDC_DATA_IN_EP,                             /* bEndpointAddress */
+  0x02,                                       /* bmAttributes: Bulk */
+  LOBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),        /* wMaxPacketSize */
+  HIBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),
+  0x00                                        /* bInterval */
+};
+
+/* Private functions ---------------------------------------------------------*/
+
+/**
+  * @brief  USBD_COMPOSITE_Init
+  *         Initialize the CDC ACM function, then open the data interface endpoints
+  * @param  pdev: device instance
+  * @param  cfgidx: Configuration index
+  * @retval status
+  */
+static uint8_t USBD_COMPOSITE_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
+{
+  uint8_t ret = USBD_CDC.Init(pdev, cfgidx);
+  if (ret != USBD_OK) {
+    return ret;
+  }
+
+  USBD_LL_OpenEP(pdev, CDC_DATA_IN_EP, USBD_EP_TYPE_BULK, CDC_DATA_FS_MAX_PACKET_SIZE);
+  USBD_LL_OpenEP(pdev, CDC_DATA_OUT_EP, USBD_EP_TYPE_BULK, CDC_DATA_FS_MAX_PACKET_SIZE);
+
+  hcdc_data.TxState = 0U;
+  hcdc_data.AltSetting = 0U;
+#if (USBD_ENABLE_MSC == 1U)
+  USBD_MSC_RO_Init(pdev);
+#else
+  hcdc_data.RxBuffer = USB_Data_RxBuffer();
+  if (hcdc_data.RxBuffer != NULL) {
+    USBD_LL_PrepareReceive(pdev, CDC_DATA_OUT_EP, hcdc_data.RxBuffer, CDC_DATA_FS_MAX_PACKET_SIZE);
+  }
+#endif
+  return USBD_OK;
+}
+
+/**
+  * @brief  USBD_COMPOSITE_DeInit
+  * @param  pdev: device instance
+  * @param  cfgidx: Configuration index
+  * @retval status
+  */
+static uint8_t USBD_COMPOSITE_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
+{
+  USBD_LL_CloseEP(pdev, CDC_DATA_IN_EP);
+  USBD_LL_CloseEP(pdev, CDC_DATA_OUT_EP);
+  hcdc_data.TxState = 0U;
+  USB_Data_TxReset();
+#if (USBD_ENABLE_MSC == 1U)
+  USBD_MSC_RO_DeInit(pdev);
+#endif
+  return USBD_CDC.DeInit(pdev, cfgidx);
+}
+
+/**
+  * @brief  USBD_COMPOSITE_Setup
+  *         Answer the standard requests of the data interface, everything
+  *         else belongs to the CDC ACM function
+  * @param  pdev: device instance
+  * @param  req: usb requests
+  * @retval status
+  */
+static uint8_t USBD_COMPOSITE_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
+{
+  static uint8_t status_info[2] = {0U, 0U};
+
+#if (USBD_ENABLE_MSC == 1U)
+  /* halt already cleared by the core, the transport may have a CSW to send */
+  if ((req->bmRequest & USB_REQ_RECIPIENT_MASK) == USB_REQ_RECIPIENT_ENDPOINT
+      && (LOBYTE(req->wIndex) & 0x7FU) == (CDC_DATA_OUT_EP & 0x7FU)) {
+    if (req->bRequest == USB_REQ_CLEAR_FEATURE) {
+      USBD_MSC_RO_ClearFeature(pdev, LOBYTE(req->wIndex));
+    }
+    return USBD_OK;
+  }
+#endif
+
+  if ((req->bmRequest & USB_REQ_RECIPIENT_MASK) != USB_REQ_RECIPIENT_INTERFACE
+      || LOBYTE(req->wIndex) != CDC_DATA_IF) {
+    return USBD_CDC.Setup(pdev, req);
+  }
+
+  if ((req->bmRequest & USB_REQ_TYPE_MASK) != USB_REQ_TYPE_STANDARD) {
+#if (USBD_ENABLE_MSC == 1U)
+    return USBD_MSC_RO_Setup(pdev, req);
+#else
+    /* no class requests without a communication interface */
+    USBD_CtlError(pdev, req);
+    return USBD_FAIL;
+#endif
+  }
+
+  switch (req->bRequest) {
+  case USB_REQ_GET_STATUS:
+    USBD_CtlSendData(pdev, status_info, 2U);
+    break;
+  case USB_REQ_GET_INTERFACE:
+    USBD_CtlSendData(pdev, &hcdc_data.AltSetting, 1U);
+    break;
+  case USB_REQ_SET_INTERFACE:
+    if (req->wValue != 0U) {
+      USBD_CtlError(pdev, req);
+      return USBD_FAIL;
+    }
+    break;
+  default:
+    USBD_CtlError(pdev, req);
+    return USBD_FAIL;
+  }
+  return USBD_OK;
+}
+
+static uint8_t USBD_COMPOSITE_EP0_RxReady(USBD_HandleTypeDef *pdev)
+{
+  return USBD_CDC.EP0_RxReady(pdev);
+}
+
+/**
+  * @brief  USBD_COMPOSITE_DataIn
+  *         End of an IN stage, the data interface ends its transfers with a
+  *         ZLP the same way USBD_CDC does
+  * @param  pdev: device instance
+  * @param  epnum: endpoint number
+  * @retval status
+  */
+static uint8_t USBD_COMPOSITE_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum)
+{
+  if (epnum != (CDC_DATA_IN_EP & 0x0FU)) {
+    uint8_t ret = USBD_CDC.DataIn(pdev, epnum);
+    CDC_TransmitCplt_FS(epnum);
+    return ret;
+  }
+
+#if (USBD_ENABLE_MSC == 1U)
+  USBD_MSC_RO_DataIn(pdev);
+#else
+  if ((pdev->ep_in[epnum].total_length > 0U)
+      && ((pdev->ep_in[epnum].total_length % CDC_DATA_FS_MAX_PACKET_SIZE) == 0U)) {
+    pdev->ep_in[epnum].total_length = 0U;
+    USBD_LL_Transmit(pdev, epnum, NULL, 0U);
+    return USBD_OK;
+  }
+  hcdc_data.TxState = 0U;
+  USB_Data_TxComplete();
+#endif
+  return USBD_OK;
+}
+
+/**
+  * @brief  USBD_COMPOSITE_DataOut
+  *         Packet received, the data interface endpoint is only re-armed when
+  *         stm32::usb_data hands a free buffer back
+  * @param  pdev: device instance
+  * @param  epnum: endpoint number
+  * @retval status
+  */
+static uint8_t USBD_COMPOSITE_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum)
+{
+  if (epnum != CDC_DATA_OUT_EP) {
+    return USBD_CDC.DataOut(pdev, epnum);
+  }
+
+#if (USBD_ENABLE_MSC == 1U)
+  USBD_MSC_RO_DataOut(pdev, USBD_LL_GetRxDataSize(pdev, epnum));
+#else
+  uint8_t *next = USB_Data_Notify(hcdc_data.RxBuffer, USBD_LL_GetRxDataSize(pdev, epnum));
+  if (next != NULL) {
+    CDC_Data_Rearm_FS(next);
+  }
+#endif
+  return USBD_OK;
+}
+
+static uint8_t *USBD_COMPOSITE_GetFSCfgDesc(uint16_t *length)
+{
+  *length = (uint16_t)sizeof(USBD_COMPOSITE_CfgFSDesc);
+  return USBD_COMPOSITE_CfgFSDesc;
+}
+
+static uint8_t *USBD_COMPOSITE_GetDeviceQualifierDescriptor(uint16_t *length)
+{
+  return USBD_CDC.GetDeviceQualifierDescriptor(length);
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  CDC_Data_Transmit_FS
+  *         Send a transfer on the data interface, see CDC_TransmitStream_FS
+  *
+  * @param  Buf: Buffer of data to be sent
+  * @param  Len: Number of data to be sent (in bytes)
+  * @param  Last: Non zero to end the transfer with a ZLP after a full packet
+  * @retval USBD_OK if all operations are OK else USBD_FAIL or USBD_BUSY
+  */
+uint8_t CDC_Data_Transmit_FS(uint8_t* Buf, uint16_t Len, uint8_t Last)
+{
+  if ((USBD_ENABLE_MSC == 1U) || (hUsbDeviceFS.dev_state != USBD_STATE_CONFIGURED)) {
+    /* interface 2 is the mass storage view */
+    return USBD_FAIL;
+  }
+  if (hcdc_data.TxState != 0U) {
+    return USBD_BUSY;
+  }
+  hcdc_data.TxState = 1U;
+  hUsbDeviceFS.ep_in[CDC_DATA_IN_EP & 0x0FU].total_length = Last ? Len : 0U;
+  return USBD_LL_Transmit(&hUsbDeviceFS, CDC_DATA_IN_EP, Buf, Len);
+}
+
+/**
+  * @brief  CDC_Data_Rearm_FS
+  *         Arm the data interface OUT endpoint on a new receive buffer
+  *
+  * @param  Buf: Buffer the next packet will be received in
+  * @retval USBD_OK if all operations are OK else USBD_FAIL
+  */
+uint8_t CDC_Data_Rearm_FS(uint8_t* Buf)
+{
+#if (USBD_ENABLE_MSC == 1U)
+  /* interface 2 is the mass storage view */
+  (void)Buf;
+  return USBD_FAIL;
+#else
+  hcdc_data.RxBuffer = Buf;
+  return USBD_LL_PrepareReceive(&hUsbDeviceFS, CDC_DATA_OUT_EP, Buf, CDC_DATA_FS_MAX_PACKET_SIZE);
+#endif
+}
@@ -0,0 +1,75 @@
+/**
+  ******************************************************************************
+  * @file           : usbd_composite.h
+  * @brief          : Header for usbd_composite.c file.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_COMPOSITE__H__
+#define __USBD_COMPOSITE__H__
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_cdc_if.h"
+
+/** @addtogroup USBD_COMPOSITE
+  * @brief Composite device: the CDC ACM function (interfaces 0 and 1) used as
+  *        command channel, plus a CDC data interface (interface 2) carrying
+  *        bulk traffic on its own endpoints. With USBD_ENABLE_MSC, interface 2
+  *        is a read-only mass storage interface instead, see usbd_msc_ro.c.
+  * @{
+  */
+
+/** @defgroup USBD_COMPOSITE_Exported_Defines USBD_COMPOSITE_Exported_Defines
+  * @{
+  */
+
+/* The OTG_FS core only has endpoints 0 to 3: the data interface gets the
+   last bulk pair and no notification endpoint. */
+#define CDC_DATA_IF                 0x02U
+#define CDC_DATA_IN_EP              0x83U
+#define CDC_DATA_OUT_EP             0x03U
+
+#define USB_COMPOSITE_CONFIG_DESC_SIZ   98U
+
+/**
+  * @}
+  */
+
+/** @defgroup USBD_COMPOSITE_Exported_Variables USBD_COMPOSITE_Exported_Variables
+  * @{
+  */
+
+extern USBD_ClassTypeDef USBD_COMPOSITE;
+
+/** Transmit buffer of the data interface, halves of stm32::usb_data */
+extern uint8_t UserTxBufferDataFS[APP_TX_DATA_SIZE];
+
+/**
+  * @}
+  */
+
+/** @defgroup USBD_COMPOSITE_Exported_Functions USBD_COMPOSITE_Exported_Functions
+  * @{
+  */
+
+uint8_t CDC_Data_Transmit_FS(uint8_t* Buf, uint16_t Len, uint8_t Last);
+uint8_t CDC_Data_Rearm_FS(uint8_t* Buf);
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_COMPOSITE__H__ */
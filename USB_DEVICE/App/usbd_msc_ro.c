@@ -0,0 +1,425 @@
+/**
+  ******************************************************************************
+  * @file           : usbd_msc_ro.c
+  * @brief          : Read-only mass storage interface of the composite device.
+  ******************************************************************************
+  * Bulk-only transport with the handful of SCSI commands hosts issue to a
+  * write protected disk. Blocks come from USB_Msc_ReadBlock() (the FAT view
+  * of the logs, see log_volume.cpp) one at a time, straight from the USB
+  * interrupt. Writes fail with DATA PROTECT.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_msc_ro.h"
+#include "usbd_composite.h"
+#include "usbd_ctlreq.h"
+
+#if (USBD_ENABLE_MSC == 1U)
+
+/* Private define ------------------------------------------------------------*/
+#define MSC_RO_CBW_SIGNATURE        0x43425355U
+#define MSC_RO_CSW_SIGNATURE        0x53425355U
+#define MSC_RO_CBW_LENGTH           31U
+#define MSC_RO_CSW_LENGTH           13U
+
+#define MSC_RO_REQ_GET_MAX_LUN      0xFEU
+#define MSC_RO_REQ_RESET            0xFFU
+
+#define MSC_RO_CSW_PASSED           0x00U
+#define MSC_RO_CSW_FAILED           0x01U
+
+#define SCSI_TEST_UNIT_READY        0x00U
+#define SCSI_REQUEST_SENSE          0x03U
+#define SCSI_INQUIRY                0x12U
+#define SCSI_MODE_SENSE6            0x1AU
+#define SCSI_START_STOP_UNIT        0x1BU
+#define SCSI_ALLOW_MEDIUM_REMOVAL   0x1EU
+#define SCSI_READ_FORMAT_CAPACITIES 0x23U
+#define SCSI_READ_CAPACITY10        0x25U
+#define SCSI_READ10                 0x28U
+#define SCSI_WRITE10                0x2AU
+#define SCSI_VERIFY10               0x2FU
+#define SCSI_MODE_SENSE10           0x5AU
+
+#define SENSE_NO_SENSE              0x00U
+#define SENSE_ILLEGAL_REQUEST       0x05U
+#define SENSE_DATA_PROTECT          0x07U
+
+#define ASC_INVALID_COMMAND         0x20U
+#define ASC_ADDRESS_OUT_OF_RANGE    0x21U
+#define ASC_INVALID_FIELD_IN_CDB    0x24U
+#define ASC_WRITE_PROTECTED         0x27U
+
+/* Private typedef -----------------------------------------------------------*/
+typedef enum
+{
+  MSC_RO_IDLE,        /* waiting for a CBW */
+  MSC_RO_DATA_IN,     /* READ(10) blocks left to send */
+  MSC_RO_LAST_DATA_IN,
+  MSC_RO_STATUS,      /* CSW sent */
+  MSC_RO_ERROR,       /* invalid CBW, stalled until reset */
+} MSC_RO_StateTypeDef;
+
+typedef struct
+{
+  uint8_t cbw[CDC_DATA_FS_MAX_PACKET_SIZE];
+  uint8_t csw[MSC_RO_CSW_LENGTH];
+  uint8_t block[MSC_RO_BLOCK_SIZE];
+  uint32_t tag;
+  uint32_t expected;  /* dCBWDataTransferLength */
+  uint32_t residue;
+  uint32_t next_block;
+  uint32_t blocks_left;
+  uint32_t last_length;
+  uint8_t status;
+  uint8_t state;
+  uint8_t csw_pending; /* CSW to send once the host clears the IN halt */
+  uint8_t sense_key;
+  uint8_t asc;
+} MSC_RO_HandleTypeDef;
+
+/* Private variables ---------------------------------------------------------*/
+extern uint32_t USB_Msc_BlockCount(void);
+extern void USB_Msc_ReadBlock(uint32_t block, uint8_t *buffer);
+
+static MSC_RO_HandleTypeDef hmsc;
+static uint8_t max_lun;
+
+static const uint8_t inquiry_data[36] =
+{
+  0x00,                                       /* direct access block device */
+  0x80,                                       /* removable */
+  0x02,                                       /* SPC-2 */
+  0x02,                                       /* response data format */
+  36U - 5U,                                   /* additional length */
+  0x00, 0x00, 0x00,
+  'S', 'T', 'M', '3', '2', ' ', ' ', ' ',     /* vendor */
+  'L', 'o', 'g', ' ', 'v', 'o', 'l', 'u',     /* product */
+  'm', 'e', ' ', ' ', ' ', ' ', ' ', ' ',
+  '1', '.', '0', ' ',                         /* revision */
+};
+
+/* Private functions ---------------------------------------------------------*/
+
+static uint32_t get_be32(const uint8_t *in)
+{
+  return ((uint32_t)in[0] << 24) | ((uint32_t)in[1] << 16) | ((uint32_t)in[2] << 8) | in[3];
+}
+
+static uint32_t get_le32(const uint8_t *in)
+{
+  return ((uint32_t)in[3] << 24) | ((uint32_t)in[2] << 16) | ((uint32_t)in[1] << 8) | in[0];
+}
+
+static void put_be32(uint8_t *out, uint32_t value)
+{
+  out[0] = (uint8_t)(value >> 24);
+  out[1] = (uint8_t)(value >> 16);
+  out[2] = (uint8_t)(value >> 8);
+  out[3] = (uint8_t)value;
+}
+
+static void put_le32(uint8_t *out, uint32_t value)
+{
+  out[0] = (uint8_t)value;
+  out[1] = (uint8_t)(value >> 8);
+  out[2] = (uint8_t)(value >> 16);
+  out[3] = (uint8_t)(value >> 24);
+}
+
+static void MSC_RO_ReceiveCBW(USBD_HandleTypeDef *pdev)
+{
+  hmsc.state = MSC_RO_IDLE;
+  USBD_LL_PrepareReceive(pdev, CDC_DATA_OUT_EP, hmsc.cbw, sizeof(hmsc.cbw));
+}
+
+static void MSC_RO_SendCSW(USBD_HandleTypeDef *pdev)
+{
+  put_le32(&hmsc.csw[0], MSC_RO_CSW_SIGNATURE);
+  put_le32(&hmsc.csw[4], hmsc.tag);
+  put_le32(&hmsc.csw[8], hmsc.residue);
+  hmsc.csw[12] = hmsc.status;
+  hmsc.csw_pending = 0U;
+  hmsc.state = MSC_RO_STATUS;
+  USBD_LL_Transmit(pdev, CDC_DATA_IN_EP, hmsc.csw, MSC_RO_CSW_LENGTH);
+}
+
+/* Data phase is over: a transfer the host expected more of and that did not
+   end on a short packet is terminated by stalling the IN endpoint. */
+static void MSC_RO_EndDataIn(USBD_HandleTypeDef *pdev)
+{
+  if ((hmsc.residue != 0U) && ((hmsc.last_length % CDC_DATA_FS_MAX_PACKET_SIZE) == 0U)) {
+    hmsc.csw_pending = 1U;
+    USBD_LL_StallEP(pdev, CDC_DATA_IN_EP);
+    return;
+  }
+  MSC_RO_SendCSW(pdev);
+}
+
+static void MSC_RO_Fail(USBD_HandleTypeDef *pdev, uint8_t sense_key, uint8_t asc)
+{
+  hmsc.sense_key = sense_key;
+  hmsc.asc = asc;
+  hmsc.status = MSC_RO_CSW_FAILED;
+  hmsc.residue = hmsc.expected;
+  if (hmsc.expected == 0U) {
+    MSC_RO_SendCSW(pdev);
+  } else if ((hmsc.cbw[12] & 0x80U) != 0U) {
+    hmsc.csw_pending = 1U;
+    USBD_LL_StallEP(pdev, CDC_DATA_IN_EP);
+  } else {
+    /* host to device data is refused, the status follows right away */
+    USBD_LL_StallEP(pdev, CDC_DATA_OUT_EP);
+    MSC_RO_SendCSW(pdev);
+  }
+}
+
+/* Short response: as much of @a data as the host asked for. */
+static void MSC_RO_Respond(USBD_HandleTypeDef *pdev, const uint8_t *data, uint32_t length)
+{
+  if ((hmsc.expected == 0U) || ((hmsc.cbw[12] & 0x80U) == 0U)) {
+    MSC_RO_Fail(pdev, SENSE_ILLEGAL_REQUEST, ASC_INVALID_FIELD_IN_CDB);
+    return;
+  }
+  if (length > hmsc.expected) {
+    length = hmsc.expected;
+  }
+  USBD_memcpy(hmsc.block, data, length);
+  hmsc.residue = hmsc.expected - length;
+  hmsc.last_length = length;
+  hmsc.state = MSC_RO_LAST_DATA_IN;
+  USBD_LL_Transmit(pdev, CDC_DATA_IN_EP, hmsc.block, length);
+}
+
+static void MSC_RO_SendNextBlock(USBD_HandleTypeDef *pdev)
+{
+  USB_Msc_ReadBlock(hmsc.next_block++, hmsc.block);
+  hmsc.blocks_left--;
+  hmsc.last_length = MSC_RO_BLOCK_SIZE;
+  hmsc.state = (hmsc.blocks_left == 0U) ? MSC_RO_LAST_DATA_IN : MSC_RO_DATA_IN;
+  USBD_LL_Transmit(pdev, CDC_DATA_IN_EP, hmsc.block, MSC_RO_BLOCK_SIZE);
+}
+
+static void MSC_RO_Read10(USBD_HandleTypeDef *pdev, const uint8_t *cb)
+{
+  uint32_t block = get_be32(&cb[2]);
+  uint32_t count = ((uint32_t)cb[7] << 8) | cb[8];
+  uint32_t blocks = USB_Msc_BlockCount();
+
+  if ((block >= blocks) || (count > blocks - block)) {
+    MSC_RO_Fail(pdev, SENSE_ILLEGAL_REQUEST, ASC_ADDRESS_OUT_OF_RANGE);
+    return;
+  }
+  if ((hmsc.cbw[12] & 0x80U) == 0U) {
+    MSC_RO_Fail(pdev, SENSE_ILLEGAL_REQUEST, ASC_INVALID_FIELD_IN_CDB);
+    return;
+  }
+  if (count > hmsc.expected / MSC_RO_BLOCK_SIZE) {
+    count = hmsc.expected / MSC_RO_BLOCK_SIZE;
+  }
+  hmsc.residue = hmsc.expected - count * MSC_RO_BLOCK_SIZE;
+  if (count == 0U) {
+    hmsc.last_length = 0U;
+    MSC_RO_EndDataIn(pdev);
+    return;
+  }
+  hmsc.next_block = block;
+  hmsc.blocks_left = count;
+  MSC_RO_SendNextBlock(pdev);
+}
+
+static void MSC_RO_Command(USBD_HandleTypeDef *pdev)
+{
+  const uint8_t *cb = &hmsc.cbw[15];
+  uint8_t response[18] = {0};
+  uint32_t last = USB_Msc_BlockCount() - 1U;
+
+  hmsc.status = MSC_RO_CSW_PASSED;
+  hmsc.residue = hmsc.expected;
+
+  switch (cb[0]) {
+  case SCSI_TEST_UNIT_READY:
+  case SCSI_START_STOP_UNIT:
+  case SCSI_ALLOW_MEDIUM_REMOVAL:
+  case SCSI_VERIFY10:
+    if (hmsc.expected != 0U) {
+      MSC_RO_Fail(pdev, SENSE_ILLEGAL_REQUEST, ASC_INVALID_FIELD_IN_CDB);
+      break;
+    }
+    MSC_RO_SendCSW(pdev);
+    break;
+
+  case SCSI_REQUEST_SENSE:
+    response[0] = 0x70U;                      /* current errors */
+    response[2] = hmsc.sense_key;
+    response[7] = 18U - 8U;                   /* additional length */
+    response[12] = hmsc.asc;
+    hmsc.sense_key = SENSE_NO_SENSE;
+    hmsc.asc = 0U;
+    MSC_RO_Respond(pdev, response, 18U);
+    break;
+
+  case SCSI_INQUIRY:
+    MSC_RO_Respond(pdev, inquiry_data, sizeof(inquiry_data));
+    break;
+
+  case SCSI_MODE_SENSE6:
+    response[0] = 3U;                         /* mode data length */
+    response[2] = 0x80U;                      /* write protected */
+    MSC_RO_Respond(pdev, response, 4U);
+    break;
+
+  case SCSI_MODE_SENSE10:
+    response[1] = 6U;
+    response[3] = 0x80U;
+    MSC_RO_Respond(pdev, response, 8U);
+    break;
+
+  case SCSI_READ_FORMAT_CAPACITIES:
+    response[3] = 8U;                         /* capacity list length */
+    put_be32(&response[4], last + 1U);
+    put_be32(&response[8], (0x02UL << 24) | MSC_RO_BLOCK_SIZE); /* formatted media */
+    MSC_RO_Respond(pdev, response, 12U);
+    break;
+
+  case SCSI_READ_CAPACITY10:
+    put_be32(&response[0], last);
+    put_be32(&response[4], MSC_RO_BLOCK_SIZE);
+    MSC_RO_Respond(pdev, response, 8U);
+    break;
+
+  case SCSI_READ10:
+    MSC_RO_Read10(pdev, cb);
+    break;
+
+  case SCSI_WRITE10:
+    MSC_RO_Fail(pdev, SENSE_DATA_PROTECT, ASC_WRITE_PROTECTED);
+    break;
+
+  default:
+    MSC_RO_Fail(pdev, SENSE_ILLEGAL_REQUEST, ASC_INVALID_COMMAND);
+    break;
+  }
+}
+
+/* Exported functions --------------------------------------------------------*/
+
+/**
+  * @brief  USBD_MSC_RO_Init
+  *         Start waiting for the first CBW, endpoints are opened by the caller
+  * @param  pdev: device instance
+  * @retval None
+  */
+void USBD_MSC_RO_Init(USBD_HandleTypeDef *pdev)
+{
+  USBD_memset(&hmsc, 0, sizeof(hmsc));
+  MSC_RO_ReceiveCBW(pdev);
+}
+
+void USBD_MSC_RO_DeInit(USBD_HandleTypeDef *pdev)
+{
+  (void)pdev;
+  hmsc.state = MSC_RO_IDLE;
+  hmsc.csw_pending = 0U;
+}
+
+/**
+  * @brief  USBD_MSC_RO_Setup
+  *         Class requests of the mass storage interface
+  * @param  pdev: device instance
+  * @param  req: usb requests
+  * @retval status
+  */
+uint8_t USBD_MSC_RO_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
+{
+  switch (req->bRequest) {
+  case MSC_RO_REQ_GET_MAX_LUN:
+    if ((req->wValue != 0U) || (req->wLength != 1U) || ((req->bmRequest & 0x80U) == 0U)) {
+      break;
+    }
+    USBD_CtlSendData(pdev, &max_lun, 1U);
+    return USBD_OK;
+
+  case MSC_RO_REQ_RESET:
+    if ((req->wValue != 0U) || (req->wLength != 0U) || ((req->bmRequest & 0x80U) != 0U)) {
+      break;
+    }
+    hmsc.csw_pending = 0U;
+    MSC_RO_ReceiveCBW(pdev);
+    USBD_CtlSendStatus(pdev);
+    return USBD_OK;
+
+  default:
+    break;
+  }
+  USBD_CtlError(pdev, req);
+  return USBD_FAIL;
+}
+
+/**
+  * @brief  USBD_MSC_RO_ClearFeature
+  *         The host cleared an endpoint halt: send the deferred CSW, or stall
+  *         again while waiting for a reset after an invalid CBW
+  * @param  pdev: device instance
+  * @param  ep_addr: endpoint address
+  * @retval None
+  */
+void USBD_MSC_RO_ClearFeature(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+  if (hmsc.state == MSC_RO_ERROR) {
+    USBD_LL_StallEP(pdev, ep_addr);
+  } else if ((ep_addr == CDC_DATA_IN_EP) && (hmsc.csw_pending != 0U)) {
+    MSC_RO_SendCSW(pdev);
+  }
+}
+
+/**
+  * @brief  USBD_MSC_RO_DataIn
+  *         IN transfer completed: next block, status or next command
+  * @param  pdev: device instance
+  * @retval None
+  */
+void USBD_MSC_RO_DataIn(USBD_HandleTypeDef *pdev)
+{
+  switch (hmsc.state) {
+  case MSC_RO_DATA_IN:
+    MSC_RO_SendNextBlock(pdev);
+    break;
+  case MSC_RO_LAST_DATA_IN:
+    MSC_RO_EndDataIn(pdev);
+    break;
+  case MSC_RO_STATUS:
+    MSC_RO_ReceiveCBW(pdev);
+    break;
+  default:
+    break;
+  }
+}
+
+/**
+  * @brief  USBD_MSC_RO_DataOut
+  *         CBW received
+  * @param  pdev: device instance
+  * @param  size: received size
+  * @retval None
+  */
+void USBD_MSC_RO_DataOut(USBD_HandleTypeDef *pdev, uint32_t size)
+{
+  if (hmsc.state != MSC_RO_IDLE) {
+    return;
+  }
+  if ((size != MSC_RO_CBW_LENGTH)
+      || (get_le32(&hmsc.cbw[0]) != MSC_RO_CBW_SIGNATURE)
+      || (hmsc.cbw[13] != 0U) || (hmsc.cbw[14] == 0U) || (hmsc.cbw[14] > 16U)) {
+    hmsc.state = MSC_RO_ERROR;
+    USBD_LL_StallEP(pdev, CDC_DATA_IN_EP);
+    USBD_LL_StallEP(pdev, CDC_DATA_OUT_EP);
+    return;
+  }
+  hmsc.tag = get_le32(&hmsc.cbw[4]);
+  hmsc.expected = get_le32(&hmsc.cbw[8]);
+  MSC_RO_Command(pdev);
+}
+
+#endif /* USBD_ENABLE_MSC */
@@ -0,0 +1,59 @@
+/**
+  ******************************************************************************
+  * @file           : usbd_msc_ro.h
+  * @brief          : Header for usbd_msc_ro.c file.
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_MSC_RO__H__
+#define __USBD_MSC_RO__H__
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_def.h"
+
+/** @addtogroup USBD_MSC_RO
+  * @brief Read-only mass storage (bulk-only transport, SCSI transparent
+  *        command set) on the composite device interface 2, replacing the
+  *        CDC data interface when USBD_ENABLE_MSC is set.
+  * @{
+  */
+
+/** @defgroup USBD_MSC_RO_Exported_Defines USBD_MSC_RO_Exported_Defines
+  * @{
+  */
+
+#define MSC_RO_BLOCK_SIZE           512U
+
+/**
+  * @}
+  */
+
+/** @defgroup USBD_MSC_RO_Exported_Functions USBD_MSC_RO_Exported_Functions
+  * @{
+  */
+
+void USBD_MSC_RO_Init(USBD_HandleTypeDef *pdev);
+void USBD_MSC_RO_DeInit(USBD_HandleTypeDef *pdev);
+uint8_t USBD_MSC_RO_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req);
+void USBD_MSC_RO_ClearFeature(USBD_HandleTypeDef *pdev, uint8_t ep_addr);
+void USBD_MSC_RO_DataIn(USBD_HandleTypeDef *pdev);
+void USBD_MSC_RO_DataOut(USBD_HandleTypeDef *pdev, uint32_t size);
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_MSC_RO__H__ */
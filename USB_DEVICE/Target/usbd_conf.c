@@ -25,7 +25,7 @@
 #include "usbd_core.h"
 
 /* USER CODE BEGIN Includes */
-
+#include "usbd_cdc.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -35,6 +35,16 @@
 /* USER CODE BEGIN PV */
 /* Private variables ---------------------------------------------------------*/
 
+/* Class data arena: the CDC ACM handle is the only USBD_malloc() user,
+ * interface 2 keeps its state in usbd_composite.c. Word aligned. */
+#define USBD_ARENA_WORDS  ((sizeof(USBD_CDC_HandleTypeDef) + 3U) / 4U)
+
+static uint32_t usbd_arena[USBD_ARENA_WORDS];
+static uint32_t usbd_arena_top;     /* words handed out */
+static uint32_t usbd_arena_live;    /* allocations not freed yet */
+static uint32_t usbd_arena_high;    /* high-water, in words */
+static uint32_t usbd_arena_failed;
+
 /* USER CODE END PV */
 
 PCD_HandleTypeDef hpcd_USB_OTG_FS;
@@ -50,6 +60,7 @@ void SystemClock_Config(void);
 /* USER CODE BEGIN PFP */
 /* Private function prototypes -----------------------------------------------*/
 USBD_StatusTypeDef USBD_Get_USB_Status(HAL_StatusTypeDef hal_status);
+extern void USB_SOF(void);
 
 /* USER CODE END PFP */
 
@@ -190,6 +201,7 @@ void HAL_PCD_SOFCallback(PCD_HandleTypeDef *hpcd)
 #endif /* USE_HAL_PCD_REGISTER_CALLBACKS */
 {
   USBD_LL_SOF((USBD_HandleTypeDef*)hpcd->pData);
+  USB_SOF();
 }
 
 /**
@@ -371,9 +383,18 @@ USBD_StatusTypeDef USBD_LL_Init(USBD_HandleTypeDef *pdev)
   HAL_PCD_RegisterIsoOutIncpltCallback(&hpcd_USB_OTG_FS, PCD_ISOOUTIncompleteCallback);
   HAL_PCD_RegisterIsoInIncpltCallback(&hpcd_USB_OTG_FS, PCD_ISOINIncompleteCallback);
 #endif /* USE_HAL_PCD_REGISTER_CALLBACKS */
+  /* 320 words of FIFO RAM, in 32-bit words:
+     - RX 128: shared by all OUT endpoints and SETUP packets,
+     - EP0 32 and the command channel (EP1) 32: two 64 byte packets each,
+     - CDC command endpoint (EP2) 16: its notifications are 8 bytes, but 16
+       words is the smallest TX FIFO the core accepts,
+     - the bulk data interface (EP3) gets the remaining 112, so several
+       packets are queued ahead of the host when streaming. */
   HAL_PCDEx_SetRxFiFo(&hpcd_USB_OTG_FS, 0x80);
-  HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_FS, 0, 0x40);
-  HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_FS, 1, 0x80);
+  HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_FS, 0, 0x20);
+  HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_FS, 1, 0x20);
+  HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_FS, 2, 0x10);
+  HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_FS, 3, 0x70);
   }
   return USBD_OK;
 }
@@ -620,6 +641,60 @@ void USBD_LL_Delay(uint32_t Delay)
   HAL_Delay(Delay);
 }
 
+/**
+  * @brief  Allocates class data from the static arena.
+  * Class data is allocated on SET_CONFIGURATION and freed on reset or
+  * unplug, all from the USB interrupt, so a bump allocator rewound when
+  * the last block is freed never fragments.
+  * @param  size: Size of allocated memory
+  * @retval Word aligned block, NULL when the arena is too small
+  */
+void *USBD_static_malloc(uint32_t size)
+{
+  uint32_t words = (size + 3U) / 4U;
+  void *block;
+
+  if (words > USBD_ARENA_WORDS - usbd_arena_top)
+  {
+    usbd_arena_failed++;
+    return NULL;
+  }
+  block = &usbd_arena[usbd_arena_top];
+  usbd_arena_top += words;
+  usbd_arena_live++;
+  if (usbd_arena_top > usbd_arena_high)
+  {
+    usbd_arena_high = usbd_arena_top;
+  }
+  return block;
+}
+
+/**
+  * @brief  Releases class data, the arena is rewound once all of it is freed.
+  * @param  p: Block returned by USBD_static_malloc()
+  * @retval None
+  */
+void USBD_static_free(void *p)
+{
+  if ((p != NULL) && (usbd_arena_live > 0U) && (--usbd_arena_live == 0U))
+  {
+    usbd_arena_top = 0U;
+  }
+}
+
+/**
+  * @brief  Reports the arena usage.
+  * @param  stats: Filled with the current usage
+  * @retval None
+  */
+void USBD_static_stats(USBD_ArenaStatsTypeDef *stats)
+{
+  stats->size = sizeof(usbd_arena);
+  stats->used = usbd_arena_top * 4U;
+  stats->high_water = usbd_arena_high * 4U;
+  stats->failed = usbd_arena_failed;
+}
+
 /**
   * @brief  Returns the USB status depending on the HAL status:
   * @param  hal_status: HAL status
@@ -63,7 +63,7 @@
   */
 
 /*---------- -----------*/
-#define USBD_MAX_NUM_INTERFACES     1U
+#define USBD_MAX_NUM_INTERFACES     3U
 /*---------- -----------*/
 #define USBD_MAX_NUM_CONFIGURATION     1U
 /*---------- -----------*/
@@ -74,6 +74,12 @@
 #define USBD_LPM_ENABLED     0U
 /*---------- -----------*/
 #define USBD_SELF_POWERED     1U
+/*---------- -----------*/
+/* Interface 2: read-only mass storage view of the logs instead of the bulk
+   CDC data interface, see usbd_msc_ro.c */
+#ifndef USBD_ENABLE_MSC
+#define USBD_ENABLE_MSC     0U
+#endif
 
 /****************************************/
 /* #define for FS and HS identification */
@@ -90,11 +96,11 @@
   */
 /* Memory management macros */
 
-/** Alias for memory allocation. */
-#define USBD_malloc         malloc
+/** Alias for memory allocation, class data comes from a static arena. */
+#define USBD_malloc         USBD_static_malloc
 
 /** Alias for memory release. */
-#define USBD_free           free
+#define USBD_free           USBD_static_free
 
 /** Alias for memory set. */
 #define USBD_memset         memset
@@ -140,6 +146,15 @@
   * @{
   */
 
+/** Usage of the USB class data arena, see USBD_static_stats(). */
+typedef struct
+{
+  uint32_t size;        /*!< arena size in bytes, fixed at link time */
+  uint32_t used;        /*!< bytes currently allocated */
+  uint32_t high_water;  /*!< most bytes ever allocated at once */
+  uint32_t failed;      /*!< allocations refused because the arena was full */
+} USBD_ArenaStatsTypeDef;
+
 /**
   * @}
   */
@@ -150,6 +165,9 @@
   */
 
 /* Exported functions -------------------------------------------------------*/
+void *USBD_static_malloc(uint32_t size);
+void USBD_static_free(void *p);
+void USBD_static_stats(USBD_ArenaStatsTypeDef *stats);
 
 /**
   * @}
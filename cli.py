@@ -1,15 +1,24 @@
+import time
+
 import click
 import serial
 import serial.tools.list_ports
+import usb.core
+import usb.util
 
 pass_serial = click.make_pass_decorator(serial.Serial)
 
+VENDOR_ID = 1155
+PRODUCT_ID = 4242
+DATA_INTERFACE = 2
+DATA_IN_EP = 0x83
+
 
 @click.group()
 @click.pass_context
 def cli(ctx):
     com_port = [p.device for p in serial.tools.list_ports.comports()
-                if p.pid == 4242][0]
+                if p.pid == PRODUCT_ID][0]
     if com_port is None:
         click.secho('Device not found', fg='red')
         return -1
@@ -40,5 +49,63 @@ def echo(com: serial.Serial, text: str):
     click.echo(com.readline().decode()[:-2])
 
 
+@cli.command()
+@pass_serial
+def usb_arena(com: serial.Serial):
+    com.write(b'usb-arena\r\n')
+    # device side: "arena <used> <high-water> <size> <failed>"
+    _, used, high, size, failed = com.readline().decode().split()
+    click.echo(f'USB class data: {used}/{size} bytes used, high-water {high}, {failed} failed')
+
+
+@cli.command()
+@pass_serial
+def run_queues(com: serial.Serial):
+    com.write(b'run-queues\r\n')
+    # device side: "queues" then "<depth> <high-water>" for high, normal and low priority,
+    # then "batch <most tasks posted between two drains>"
+    values = com.readline().decode().split()[1:]
+    queues, batch = values[:-2], values[-1]
+    for name, depth, high in zip(('high', 'normal', 'low'), queues[::2], queues[1::2]):
+        click.echo(f'{name}: {depth} ready, high-water {high}')
+    click.echo(f'posted batch high-water: {batch}')
+
+
+@cli.command()
+@click.option('--size', default=1_000_000, show_default=True, help='Bytes to stream')
+@pass_serial
+def stream_bench(com: serial.Serial, size: int):
+    # the stream goes out on the bulk data interface, not on the tty
+    dev = usb.core.find(idVendor=VENDOR_ID, idProduct=PRODUCT_ID)
+    if dev is None:
+        click.secho('Device not found', fg='red')
+        return
+    usb.util.claim_interface(dev, DATA_INTERFACE)
+    com.write(f'stream-bench {size}\r\n'.encode())
+    click.echo(com.readline().decode()[:-2])
+    pattern = bytes(range(256)) * 258
+    received = 0
+    errors = 0
+    start = time.perf_counter()
+    while received < size:
+        try:
+            chunk = bytes(dev.read(DATA_IN_EP, min(size - received, 0x10000), timeout=1000))
+        except usb.core.USBTimeoutError:
+            click.secho(f'timeout after {received} bytes', fg='red')
+            break
+        offset = received % 256
+        if chunk != pattern[offset:offset + len(chunk)]:
+            errors += 1
+        received += len(chunk)
+    elapsed = time.perf_counter() - start
+    usb.util.release_interface(dev, DATA_INTERFACE)
+    # device side: "stream <bytes> <transfers> <stalls>"
+    _, sent, transfers, stalls = com.readline().decode().split()
+    click.echo(f'{received} bytes in {elapsed:.3f}s: {received / elapsed / 1e6:.3f} MB/s')
+    click.echo(f'device: {sent} bytes, {transfers} transfers, {stalls} stalls')
+    if errors:
+        click.secho(f'{errors} corrupted chunks', fg='red')
+
+
 if __name__ == '__main__':
     cli()
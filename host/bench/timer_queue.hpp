@@ -0,0 +1,97 @@
+/** @file timer_queue.hpp
+ *
+ * @date Oct 17, 2026
+ * @author Sylvain Garcia
+ */
+
+#pragma once
+
+/** The sorted list tickless_context used before timing_wheel, kept as the
+ * baseline of timing_wheel_bench.
+ */
+namespace baseline {
+
+/** Intrusive link of a pending timer, see timer_queue. */
+template <typename Clock>
+struct timer_node {
+	typename Clock::time_point due_{};
+	timer_node *next_ = nullptr;
+	timer_node *prev_ = nullptr;
+	bool queued_ = false;
+};
+
+/** Pending timers sorted by due time, earliest first.
+ *
+ * Intrusive and allocation free. Insertion is O(n), the earliest timer and
+ * its removal are O(1), which is all the compare interrupt needs. Timers due
+ * at the same time fire in insertion order. Not synchronized: the owner
+ * serializes accesses.
+ */
+template <typename Clock>
+class timer_queue {
+public:
+	using node = timer_node<Clock>;
+	using time_point = typename Clock::time_point;
+
+	bool empty() const noexcept {
+		return head_ == nullptr;
+	}
+
+	node *earliest() const noexcept {
+		return head_;
+	}
+
+	/** Queue @a n, returns true when it became the earliest timer. */
+	bool insert(node &n) noexcept {
+		node *prev = nullptr;
+		node *next = head_;
+		while (next != nullptr && !(n.due_ < next->due_)) {
+			prev = next;
+			next = next->next_;
+		}
+		n.prev_ = prev;
+		n.next_ = next;
+		n.queued_ = true;
+		if (next != nullptr) {
+			next->prev_ = &n;
+		}
+		if (prev != nullptr) {
+			prev->next_ = &n;
+			return false;
+		}
+		head_ = &n;
+		return true;
+	}
+
+	/** Take @a n out, false if it was not queued (already popped). */
+	bool remove(node &n) noexcept {
+		if (!n.queued_) {
+			return false;
+		}
+		if (n.prev_ != nullptr) {
+			n.prev_->next_ = n.next_;
+		} else {
+			head_ = n.next_;
+		}
+		if (n.next_ != nullptr) {
+			n.next_->prev_ = n.prev_;
+		}
+		n.next_ = n.prev_ = nullptr;
+		n.queued_ = false;
+		return true;
+	}
+
+	/** Pop the earliest timer if it is due at @a now, nullptr otherwise. */
+	node *pop_due(time_point now) noexcept {
+		if (head_ == nullptr || now < head_->due_) {
+			return nullptr;
+		}
+		auto *n = head_;
+		remove(*n);
+		return n;
+	}
+
+private:
+	node *head_ = nullptr;
+};
+}
@@ -0,0 +1,74 @@
+/*
+ * timing_wheel_bench.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Sylvain Garcia
+ */
+
+// Cost of one scheduler step, timing_wheel against the sorted list it
+// replaced: cancel a random pending timer, start it again within 2s, advance
+// the clock by 10us and restart whatever expired one second later.
+
+#include "timer_queue.hpp"
+
+#include <host_timer.hpp>
+#include <timing_wheel.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+
+using sim_clock = stm32::host_clock;
+
+constexpr int steps = 200'000;
+
+sim_clock::time_point at(int64_t us) {
+	return sim_clock::time_point{sim_clock::duration{us}};
+}
+
+/** Nanoseconds per step with @a pending timers queued. */
+template <typename Queue, typename Node>
+double run(std::size_t pending) {
+	Queue queue;
+	std::vector<Node> nodes(pending);
+	std::mt19937 rng{1};
+	int64_t now = 0;
+	auto const later = [&rng, &now] {
+		return at(now + 1000 + int64_t(rng() % 2'000'000));
+	};
+	for (auto &node : nodes) {
+		node.due_ = later();
+		queue.insert(node);
+	}
+	auto const start = std::chrono::steady_clock::now();
+	for (int step = 0; step < steps; ++step) {
+		auto &node = nodes[rng() % pending];
+		queue.remove(node);
+		node.due_ = later();
+		queue.insert(node);
+		now += 10;
+		while (auto *due = queue.pop_due(at(now))) {
+			due->due_ += std::chrono::seconds{1};
+			queue.insert(*due);
+		}
+	}
+	auto const elapsed = std::chrono::steady_clock::now() - start;
+	return std::chrono::duration<double, std::nano>(elapsed).count() / steps;
+}
+
+}
+
+int main() {
+	std::printf("pending  sorted list  timing wheel  (ns per step)\n");
+	for (std::size_t pending : {10, 100, 1000}) {
+		auto const list = run<baseline::timer_queue<sim_clock>, baseline::timer_node<sim_clock>>(pending);
+		auto const wheel = run<stm32::timing_wheel<sim_clock>, stm32::timer_node<sim_clock>>(pending);
+		std::printf("%7zu  %11.0f  %12.0f\n", pending, list, wheel);
+	}
+	return 0;
+}
@@ -0,0 +1,145 @@
+/*
+ * fat_view_test.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Sylvain Garcia
+ */
+
+// Reads every sector of a fat_view like a host mounting the mass storage
+// interface would: the boot sector describes the volume, LOG.TXT is found in
+// the root directory, its FAT chain is followed and its clusters hold the
+// source bytes.
+
+#include <fat_view.hpp>
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace {
+
+/** What log_store provides, without the formatting. */
+struct text_source {
+	static constexpr std::size_t capacity = 12000;
+
+	std::string text;
+
+	std::size_t size() const noexcept {
+		return text.size();
+	}
+
+	std::size_t read(std::size_t offset, std::span<uint8_t> out) const noexcept {
+		if (offset >= text.size()) {
+			return 0;
+		}
+		auto const count = std::min(out.size(), text.size() - offset);
+		std::memcpy(out.data(), text.data() + offset, count);
+		return count;
+	}
+};
+
+using view = stm32::fat_view<text_source>;
+using sector = std::array<uint8_t, view::block_size>;
+
+uint16_t get16(uint8_t const *in) {
+	return uint16_t(in[0] | in[1] << 8);
+}
+
+uint32_t get32(uint8_t const *in) {
+	return get16(in) | uint32_t(get16(in + 2)) << 16;
+}
+
+std::vector<sector> image(view const &volume) {
+	std::vector<sector> sectors(view::block_count);
+	for (uint32_t ii = 0; ii < view::block_count; ++ii) {
+		volume.read(ii, sectors[ii]);
+	}
+	// past the end reads as zeroes
+	sector past;
+	past.fill(0xAA);
+	volume.read(view::block_count, past);
+	for (auto byte : past) {
+		assert(byte == 0);
+	}
+	return sectors;
+}
+
+/** LOG.TXT contents as a FAT12 driver reads them. */
+std::string mount(std::vector<sector> const &sectors) {
+	auto const *boot = sectors[0].data();
+	assert(boot[510] == 0x55 && boot[511] == 0xAA);
+	assert(std::memcmp(boot + 54, "FAT12   ", 8) == 0);
+	assert(get16(boot + 11) == view::block_size);
+	assert(boot[13] == 1);
+	assert(get16(boot + 19) == view::block_count);
+
+	auto const reserved = get16(boot + 14);
+	auto const fats = boot[16];
+	auto const root_entries = get16(boot + 17);
+	auto const fat_size = get16(boot + 22);
+	auto const root_start = reserved + fats * fat_size;
+	auto const data_start = root_start + (root_entries * 32 + view::block_size - 1) / view::block_size;
+
+	std::vector<uint8_t> fat;
+	for (uint32_t ii = reserved; ii < uint32_t(reserved + fat_size); ++ii) {
+		fat.insert(fat.end(), sectors[ii].begin(), sectors[ii].end());
+	}
+	auto const entry = [&fat](uint32_t cluster) {
+		auto const pair = get16(&fat[cluster * 3 / 2]);
+		return uint16_t(cluster % 2 ? pair >> 4 : pair & 0xFFF);
+	};
+	assert(entry(0) == 0xFF8 && entry(1) == 0xFFF);
+
+	uint8_t const *file = nullptr;
+	for (uint32_t ii = 0; ii < root_entries; ++ii) {
+		auto const *dir = sectors[root_start].data() + ii * 32;
+		if (std::memcmp(dir, "LOG     TXT", 11) == 0) {
+			file = dir;
+		}
+	}
+	assert(file != nullptr);
+	auto const size = get32(file + 28);
+	uint32_t cluster = get16(file + 26);
+	assert((size == 0) == (cluster == 0));
+
+	std::string text;
+	uint32_t clusters = 0;
+	while (size != 0 && cluster < 0xFF8) {
+		assert(cluster >= 2 && data_start + cluster - 2 < view::block_count);
+		auto const &data = sectors[data_start + cluster - 2];
+		text.append(data.begin(), data.end());
+		clusters += 1;
+		cluster = entry(cluster);
+	}
+	assert(clusters == (size + view::block_size - 1) / view::block_size);
+	text.resize(size);
+	return text;
+}
+
+}
+
+int main() {
+	text_source source;
+	view volume{source};
+
+	assert(mount(image(volume)).empty());
+
+	for (int ii = 0; source.text.size() < 3 * view::block_size + 17; ++ii) {
+		source.text += std::to_string(ii) + " line " + std::to_string(ii * 7) + "\r\n";
+	}
+	assert(mount(image(volume)) == source.text);
+
+	// a grown file shows up on the next mount
+	while (source.text.size() + 10 <= text_source::capacity) {
+		source.text += "0123456789";
+	}
+	assert(mount(image(volume)) == source.text);
+
+	std::printf("%u sectors, %zu bytes\n", view::block_count, source.text.size());
+	return 0;
+}
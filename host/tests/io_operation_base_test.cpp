@@ -0,0 +1,183 @@
+/*
+ * io_operation_base_test.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Sylvain Garcia
+ */
+
+// A thread stands in for the interrupt completing an operation while the main
+// thread cancels it: the receiver completes exactly once, never from the
+// interrupt while a stop callback is registered, and the completion deferred
+// to io_completions carries its value. A deadline is expired by the
+// io_deadlines alarm, programmed for the earliest armed one.
+
+#include <io_operation_base.hpp>
+
+#include <unifex/inplace_stop_token.hpp>
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <system_error>
+#include <thread>
+
+namespace {
+
+struct outcome {
+	std::atomic<int> completions{0};
+	std::atomic<bool> in_isr{false};
+	int value = 0;
+	bool done = false;
+};
+
+struct cancellable_receiver {
+	outcome *out_;
+	unifex::inplace_stop_source *source_;
+
+	void record() noexcept {
+		out_->in_isr.store(out_->in_isr.load() || stm32::in_isr());
+		out_->completions.fetch_add(1);
+	}
+	void set_value(int value) && noexcept {
+		out_->value = value;
+		record();
+	}
+	void set_error(std::error_code) && noexcept {
+		record();
+	}
+	void set_done() && noexcept {
+		out_->done = true;
+		record();
+	}
+	friend unifex::inplace_stop_token tag_invoke(unifex::tag_t<unifex::get_stop_token>,
+			cancellable_receiver const &r) noexcept {
+		return r.source_->get_token();
+	}
+};
+
+struct plain_receiver {
+	outcome *out_;
+
+	void set_value(int value) && noexcept {
+		out_->value = value;
+		out_->in_isr.store(stm32::in_isr());
+		out_->completions.fetch_add(1);
+	}
+	void set_error(std::error_code) && noexcept {}
+	void set_done() && noexcept {
+		out_->done = true;
+		out_->completions.fetch_add(1);
+	}
+};
+
+/// armed by start_io, what an interrupt binding would do
+std::atomic<bool> armed{false};
+
+template <typename Receiver>
+struct operation : stm32::io_operation_base<operation, Receiver> {
+
+	explicit operation(Receiver &&r, stm32::io_deadline deadline = {}) noexcept:
+		stm32::io_operation_base<operation, Receiver>{(Receiver &&)r, deadline} {
+	}
+
+	void start_io() noexcept {
+		armed.store(true, std::memory_order_release);
+		this->resume_pending();
+	}
+
+	bool stop_io() noexcept {
+		armed.store(false, std::memory_order_relaxed);
+		return false;
+	}
+
+	void on_isr(int value) noexcept {
+		if (!this->try_claim()) {
+			return;
+		}
+		armed.store(false, std::memory_order_relaxed);
+		std::move(*this).set_value(value);
+	}
+};
+
+constexpr int rounds = 200'000;
+
+}
+
+int main() {
+	int values = 0;
+	int dones = 0;
+	for (int round = 0; round < rounds; ++round) {
+		outcome out;
+		unifex::inplace_stop_source source;
+		operation<cancellable_receiver> op{cancellable_receiver{&out, &source}};
+		armed.store(false);
+		op.start();
+
+		std::thread isr{[&] {
+			stm32::host_isr::active = true;
+			if (armed.load(std::memory_order_acquire)) {
+				op.on_isr(round);
+			}
+		}};
+		if (round % 2 == 0) {
+			source.request_stop();
+		}
+		isr.join();
+		if (round % 2 != 0) {
+			source.request_stop();
+		}
+		while (out.completions.load() == 0) {
+			stm32::io_completions::drain();
+		}
+		assert(stm32::io_completions::empty());
+		assert(out.completions.load() == 1);
+		assert(!out.in_isr.load());
+		if (out.done) {
+			dones += 1;
+		} else {
+			assert(out.value == round);
+			values += 1;
+		}
+	}
+	assert(values + dones == rounds);
+
+	// nothing to unregister: an uncancellable operation completes in the interrupt
+	outcome out;
+	operation<plain_receiver> op{plain_receiver{&out}};
+	op.start();
+	std::thread isr{[&] {
+		stm32::host_isr::active = true;
+		op.on_isr(7);
+	}};
+	isr.join();
+	assert(out.completions.load() == 1 && out.in_isr.load() && out.value == 7);
+	assert(stm32::io_completions::empty());
+
+	// deadlines: the alarm follows the earliest one and nothing is left armed
+	{
+		using namespace std::chrono_literals;
+		outcome first;
+		outcome second;
+		operation<plain_receiver> late{plain_receiver{&second}, 5ms};
+		operation<plain_receiver> early{plain_receiver{&first}, 2ms};
+		late.start();
+		early.start();
+		assert(stm32::host_timer::alarm_armed_);
+		assert(stm32::host_timer::alarm_due_ == stm32::io_clock::now() + 2ms);
+		stm32::host_clock::advance(2ms);
+		stm32::io_deadlines::expire();
+		assert(first.done && first.completions.load() == 1 && second.completions.load() == 0);
+		assert(stm32::host_timer::alarm_due_ == stm32::io_clock::now() + 3ms);
+		late.on_isr(1);
+		assert(second.completions.load() == 1 && second.value == 1);
+		// disarming leaves the alarm, firing it expires nothing and cancels it
+		stm32::host_clock::advance(3ms);
+		stm32::io_deadlines::expire();
+		assert(second.completions.load() == 1);
+		assert(!stm32::host_timer::alarm_armed_);
+	}
+
+	std::printf("%d values, %d cancelled\n", values, dones);
+	return 0;
+}
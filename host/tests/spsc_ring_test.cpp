@@ -0,0 +1,66 @@
+/*
+ * spsc_ring_test.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Sylvain Garcia
+ */
+
+// A producer thread stands in for the USB interrupt, the main thread drains
+// like rx_sender: every published packet arrives once, in order and intact.
+
+#include <spsc_ring.hpp>
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+
+namespace {
+
+struct packet {
+	uint32_t seq;
+	std::array<uint32_t, 15> payload;
+};
+
+constexpr uint32_t attempts = 2'000'000;
+
+}
+
+int main() {
+	stm32::spsc_ring<packet, 8> ring;
+	uint32_t published = 0;
+
+	std::thread isr{[&] {
+		for (uint32_t seq = 0; seq < attempts; ++seq) {
+			if (auto *slot = ring.prepare()) {
+				slot->seq = seq;
+				slot->payload.fill(seq);
+				ring.commit();
+				published += 1;
+			}
+		}
+	}};
+
+	uint32_t received = 0;
+	int64_t last = -1;
+	bool producing = true;
+	while (producing || !ring.empty()) {
+		producing = received + ring.overflows() < attempts;
+		if (auto *slot = ring.front()) {
+			assert(int64_t(slot->seq) > last);
+			for (auto word : slot->payload) {
+				assert(word == slot->seq);
+			}
+			last = slot->seq;
+			ring.pop();
+			received += 1;
+		}
+	}
+	isr.join();
+
+	assert(received == published);
+	assert(received + ring.overflows() == attempts);
+	std::printf("spsc_ring: %u received, %zu overflows\n", received, ring.overflows());
+	return 0;
+}
@@ -0,0 +1,221 @@
+/*
+ * tickless_context_test.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: Sylvain Garcia
+ */
+
+// Drives tickless_context on host_timer, whose sleeps jump the clock to the
+// armed compare: work runs in priority then deadline order, a cancelled timer
+// completes with done on the context, the periodic stream does not drift nor
+// accept a period below one tick, and the core only wakes up for the timing
+// wheel slots holding deadlines.
+
+#include <tickless_context.hpp>
+#include <host_timer.hpp>
+
+#include <unifex/inplace_stop_token.hpp>
+
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <optional>
+#include <utility>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+using context = stm32::tickless_context<stm32::host_timer>;
+
+context *current = nullptr;
+std::vector<int> order;
+
+int64_t now_us() {
+	return stm32::host_clock::now().time_since_epoch().count();
+}
+
+struct receiver {
+	int id_;
+	unifex::inplace_stop_source *source_ = nullptr;
+
+	void set_value() && noexcept {
+		order.push_back(id_);
+	}
+	void set_done() && noexcept {
+		order.push_back(-id_);
+	}
+	friend unifex::inplace_stop_token tag_invoke(unifex::tag_t<unifex::get_stop_token>,
+			receiver const &r) noexcept {
+		return r.source_ != nullptr ? r.source_->get_token() : unifex::inplace_stop_token{};
+	}
+};
+
+void reset() {
+	order.clear();
+	stm32::host_timer::arms_ = 0;
+	stm32::host_timer::idles_ = 0;
+	stm32::host_timer::idle_hook = [] {
+		current->stop();
+	};
+}
+
+void expiry_order() {
+	context ctx;
+	current = &ctx;
+	reset();
+	auto const start = now_us();
+	auto scheduler = ctx.get_scheduler();
+	unifex::inplace_stop_source source;
+	auto late = scheduler.schedule_after(250ms).connect(receiver{1});
+	auto at = scheduler.schedule_at(scheduler.now() + 37us).connect(receiver{2});
+	auto after = scheduler.schedule_after(37us).connect(receiver{3});
+	auto now = scheduler.schedule().connect(receiver{4});
+	auto cancelled = scheduler.schedule_after(1s).connect(receiver{5, &source});
+	late.start();
+	at.start();
+	after.start();
+	now.start();
+	cancelled.start();
+	source.request_stop();
+	ctx.run();
+
+	// posted work first, oldest first, then deadlines, same deadline in start order
+	assert((order == std::vector<int>{4, -5, 2, 3, 1}));
+	assert(now_us() - start == 250'000);
+	// 37us, then the level 2 and level 1 slots holding 250ms, 250ms itself
+	assert(stm32::host_timer::arms_ == 4);
+	// the same four wake-ups, and the last sleep with nothing armed
+	assert(stm32::host_timer::idles_ == 5);
+}
+
+void priorities() {
+	context ctx;
+	current = &ctx;
+	reset();
+	auto low = ctx.get_scheduler(stm32::priority::low);
+	auto high = ctx.get_scheduler(stm32::priority::high);
+	auto normal = ctx.get_scheduler();
+	assert(!(low == high) && normal == ctx.get_scheduler(stm32::priority::normal));
+	auto a = low.schedule().connect(receiver{1});
+	auto b = low.schedule().connect(receiver{2});
+	auto c = normal.schedule().connect(receiver{3});
+	auto d = high.schedule().connect(receiver{4});
+	auto e = low.schedule_after(10us).connect(receiver{5});
+	auto f = high.schedule_after(10us).connect(receiver{6});
+	auto g = normal.schedule_after(5us).connect(receiver{7});
+	e.start();
+	f.start();
+	g.start();
+	a.start();
+	b.start();
+	c.start();
+	d.start();
+	stm32::host_clock::advance(20us);
+	ctx.run();
+
+	// everything is due at once: highest level first, FIFO within a level
+	assert((order == std::vector<int>{4, 6, 3, 7, 1, 2, 5}));
+	auto const stats = ctx.stats(stm32::priority::low);
+	assert(stats.depth == 0 && stats.high_water == 3);
+	assert(ctx.batch_high_water() == 4);
+	assert(stm32::host_timer::arms_ == 0);
+}
+
+struct tick_receiver {
+	void set_value(uint32_t missed) && noexcept;
+	void set_done() && noexcept;
+	friend unifex::inplace_stop_token tag_invoke(unifex::tag_t<unifex::get_stop_token>,
+			tick_receiver const &) noexcept;
+};
+
+struct periodic {
+	context::every_stream *stream_;
+	unifex::inplace_stop_source source_;
+	std::vector<std::pair<int64_t, uint32_t>> ticks_;
+	int64_t start_;
+	int dones_ = 0;
+
+	using operation = decltype(std::declval<context::every_stream &>().next().connect(std::declval<tick_receiver>()));
+	std::optional<operation> ops_[2];
+	int current_ = 0;
+
+	void next();
+};
+
+periodic *stream_state = nullptr;
+
+void tick_receiver::set_value(uint32_t missed) && noexcept {
+	auto &state = *stream_state;
+	state.ticks_.push_back({now_us() - state.start_, missed});
+	auto const count = state.ticks_.size();
+	if (count == 2) {
+		// slow consumer: two periods missed, skipped
+		stm32::host_clock::advance(25ms);
+	} else if (count == 3) {
+		// late within the period: no drift
+		stm32::host_clock::advance(3ms);
+	} else if (count == 5) {
+		state.stream_->period(20ms);
+	}
+	state.next();
+	if (count == 7) {
+		state.source_.request_stop();
+	}
+}
+
+void tick_receiver::set_done() && noexcept {
+	stream_state->dones_ += 1;
+	current->stop();
+}
+
+unifex::inplace_stop_token tag_invoke(unifex::tag_t<unifex::get_stop_token>, tick_receiver const &) noexcept {
+	return stream_state->source_.get_token();
+}
+
+void periodic::next() {
+	// the previous operation is still completing, alternate between two
+	current_ ^= 1;
+	ops_[current_].reset();
+	ops_[current_].emplace(stream_->next().connect(tick_receiver{}));
+	ops_[current_]->start();
+}
+
+void every() {
+	context ctx;
+	current = &ctx;
+	reset();
+	periodic state;
+	stream_state = &state;
+	state.start_ = now_us();
+	auto stream = stm32::schedule_every(ctx.get_scheduler(), 10ms);
+	state.stream_ = &stream;
+	state.next();
+	ctx.run();
+
+	std::vector<std::pair<int64_t, uint32_t>> const expected{
+		{10'000, 0}, {20'000, 0}, {45'000, 1}, {50'000, 0}, {60'000, 0}, {80'000, 0}, {100'000, 0}};
+	assert(state.ticks_ == expected);
+	assert(state.dones_ == 1);
+}
+
+void zero_period() {
+	context ctx;
+	auto stream = stm32::schedule_every(ctx.get_scheduler(), 0ms);
+	assert(stream.period() == 1us);
+	assert(!stream.period(0ms) && !stream.period(-5ms));
+	assert(stream.period() == 1us);
+	assert(stream.period(2ms) && stream.period() == 2ms);
+}
+
+}
+
+int main() {
+	expiry_order();
+	priorities();
+	every();
+	zero_period();
+	std::puts("ok");
+	return 0;
+}